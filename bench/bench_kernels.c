@@ -0,0 +1,438 @@
+/* Standalone benchmark driver for the particle kernels.
+ *
+ * Links the update, indexing, culling and blitting kernels directly and times
+ * them in isolation, once per SIMD level the machine supports. Results are
+ * written as JSON (to stdout, or to the path given as the first argument) so
+ * they can be stored and compared between commits.
+ *
+ * The kernels allocate through PyMem, so a bare interpreter is initialized,
+ * but neither pygame nor a display is needed: the animation frames and the
+ * destination are plain SDL surfaces wrapped in pgSurfaceObject structs, the
+ * frames being packed into a SpriteAtlas the same way Emitter does. */
+
+#include "../src/include/data_block.h"
+#include "../src/include/simd_common.h"
+
+SIMDLevel max_simd_level = _SIMD_AVX2;
+
+#define DEST_WIDTH 1024
+#define DEST_HEIGHT 768
+#define NUM_FRAMES 4
+#define BENCH_SEED 5489U
+
+#define MIN_SAMPLE_NS 2000000.0 /* grow iterations until a sample takes this */
+#define NUM_SAMPLES 7           /* the fastest sample is reported */
+
+static const int particle_counts[] = {1000, 10000, 100000};
+static const int sprite_sizes[] = {1, 2, 3, 4, 8, 16};
+
+#define ARRAY_LEN(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+static const char *const simd_names[] = {"scalar", "sse2", "avx2"};
+
+typedef struct {
+    DataBlock block;
+    pgSurfaceObject *dest;
+} BenchCase;
+
+typedef struct {
+    const char *name;
+    bool use_acc_x;
+    bool use_acc_y;
+    bool compact;
+} UpdaterVariant;
+
+static const UpdaterVariant updater_variants[] = {
+    {"update_particles", false, false},
+    {"update_particles_acc_x", true, false},
+    {"update_particles_acc_y", false, true},
+    {"update_particles_acc_xy", true, true},
+    {"update_particles_acc_xy_compact", true, true, true},
+};
+
+typedef struct {
+    FILE *out;
+    int entries;
+} Report;
+
+static ScratchArena scratch;
+
+/* Every particle drawn and recorded, so the blitters have the whole map to
+ * work on, nothing profiled */
+static const DrawContext draw_ctx = {
+    .stride = 1,
+    .scratch = &scratch,
+    .materialize = true,
+};
+
+/* What the module draws with, sprites are blitted while the map is built */
+static const DrawContext stream_ctx = {
+    .stride = 1,
+    .scratch = &scratch,
+};
+
+/* ====================| Fixtures |==================== */
+
+static pgSurfaceObject *
+make_surface(int w, int h, uint32_t color)
+{
+    pgSurfaceObject *obj = PyMem_Calloc(1, sizeof(pgSurfaceObject));
+    if (!obj)
+        return NULL;
+
+    PyObject_Init((PyObject *)obj, &PyBaseObject_Type);
+
+    obj->surf = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!obj->surf) {
+        PyMem_Free(obj);
+        return NULL;
+    }
+
+    SDL_FillRect(obj->surf, NULL, color);
+
+    return obj;
+}
+
+static void
+free_surface(pgSurfaceObject *obj)
+{
+    SDL_FreeSurface(obj->surf);
+    PyMem_Free(obj);
+}
+
+/* The atlas holds a copy of the pixels, so the frames are freed right away */
+static SpriteAtlas *
+make_atlas(int size)
+{
+    pgSurfaceObject *frames[NUM_FRAMES];
+    SpriteAtlas *atlas = NULL;
+    int i;
+
+    for (i = 0; i < NUM_FRAMES; i++) {
+        frames[i] = make_surface(size, size, 0xFF102030u + 0x00101010u * i);
+        if (!frames[i])
+            goto on_exit;
+    }
+
+    atlas = sprite_atlas_from_frames((PyObject *const *)frames, NUM_FRAMES);
+
+on_exit:
+    while (i--)
+        free_surface(frames[i]);
+
+    return atlas;
+}
+
+static int
+setup_case(BenchCase *bc, const UpdaterVariant *variant, int count, int sprite,
+           SpriteAtlas *atlas, pgSurfaceObject *dest)
+{
+    MTState rng;
+    init_genrand(&rng, BENCH_SEED);
+
+    Emitter emitter = {
+        .spawn_shape = _POINT,
+        .emission_number = count,
+        .num_frames = NUM_FRAMES,
+        .atlas = atlas,
+        .lifetime = {30.0f, 120.0f, 1, true},
+        .speed_x = {-2.0f, 2.0f, 1, true},
+        .speed_y = {-2.0f, 2.0f, 1, true},
+        .acceleration_x = {-0.1f, 0.1f, 1, variant->use_acc_x},
+        .acceleration_y = {0.0f, 0.2f, 1, variant->use_acc_y},
+        .blend_mode = 1,
+        .compact = variant->compact,
+    };
+
+    memset(bc, 0, sizeof(BenchCase));
+    bc->dest = dest;
+
+    vec2 origin = {0.0f, 0.0f};
+    if (!init_data_block(&bc->block, &emitter, origin, &rng))
+        return 0;
+
+    /* Spread the particles over the destination, with a margin so that some
+     * of them get clipped on every side like in a real scene */
+    float *px = bc->block.positions_x.data;
+    float *py = bc->block.positions_y.data;
+    for (int i = 0; i < count; i++) {
+        px[i] = rand_between(&rng, (float)-sprite, (float)DEST_WIDTH);
+        py[i] = rand_between(&rng, (float)-sprite, (float)DEST_HEIGHT);
+    }
+
+    /* Age the block like a running effect would, so every animation frame is
+     * in use */
+    bc->block.age = 25.0f;
+
+    return prepare_fragmentation_map(&bc->block, &scratch, true);
+}
+
+/* ====================| Kernels under test |==================== */
+
+static void
+run_updater(BenchCase *bc)
+{
+    bc->block.updater(&bc->block, 0.001f);
+}
+
+static void
+run_index_occurrences(BenchCase *bc)
+{
+    calculate_surface_index_occurrences(&bc->block);
+}
+
+static void
+run_fragmentation_map(BenchCase *bc)
+{
+    calculate_fragmentation_map(bc->dest, &bc->block, &draw_ctx);
+}
+
+/* Culls and blits in one pass, the block's blend mode picks the blitter */
+static void
+run_stream(BenchCase *bc)
+{
+    calculate_fragmentation_map(bc->dest, &bc->block, &stream_ctx);
+}
+
+static void
+run_blit_blitcopy(BenchCase *bc)
+{
+    blit_fragments_blitcopy(&bc->block.frag_map, bc->dest, &bc->block);
+}
+
+static void
+run_blit_add(BenchCase *bc)
+{
+    blit_fragments_add(&bc->block.frag_map, bc->dest, &bc->block);
+}
+
+/* ====================| Timing and reporting |==================== */
+
+static double
+now_ns(void)
+{
+    return (double)SDL_GetPerformanceCounter() * 1e9 /
+           (double)SDL_GetPerformanceFrequency();
+}
+
+/* Returns the best observed ns per particle, iterations are doubled until a
+ * single sample is long enough for the timer resolution not to matter */
+static double
+time_kernel(void (*kernel)(BenchCase *), BenchCase *bc, int *out_iterations)
+{
+    int iterations = 1;
+    double elapsed;
+
+    for (;;) {
+        double start = now_ns();
+        for (int i = 0; i < iterations; i++)
+            kernel(bc);
+        elapsed = now_ns() - start;
+
+        if (elapsed >= MIN_SAMPLE_NS || iterations >= (1 << 20))
+            break;
+
+        iterations *= 2;
+    }
+
+    double best = elapsed;
+    for (int s = 1; s < NUM_SAMPLES; s++) {
+        double start = now_ns();
+        for (int i = 0; i < iterations; i++)
+            kernel(bc);
+        elapsed = now_ns() - start;
+
+        if (elapsed < best)
+            best = elapsed;
+    }
+
+    *out_iterations = iterations;
+
+    return best / iterations / bc->block.particles_count;
+}
+
+static void
+report(Report *r, const char *kernel, SIMDLevel level, int count, int sprite,
+       double ns_per_particle, int iterations)
+{
+    fprintf(r->out,
+            "%s\n    {\"kernel\": \"%s\", \"simd\": \"%s\", \"particles\": %d, "
+            "\"sprite\": %d, \"ns_per_particle\": %.4f, \"iterations\": %d}",
+            r->entries ? "," : "", kernel, simd_names[level], count, sprite,
+            ns_per_particle, iterations);
+    r->entries++;
+}
+
+static void
+bench_case(Report *r, const char *name, void (*kernel)(BenchCase *), BenchCase *bc,
+           SIMDLevel level, int sprite)
+{
+    int iterations;
+    double ns = time_kernel(kernel, bc, &iterations);
+
+    report(r, name, level, bc->block.particles_count, sprite, ns, iterations);
+}
+
+static bool
+simd_level_supported(SIMDLevel level)
+{
+    max_simd_level = level;
+
+    switch (level) {
+        case _SIMD_AVX2:
+            return _Has_AVX2();
+        case _SIMD_SSE2:
+            return _HasSSE_NEON();
+        default:
+            return true;
+    }
+}
+
+/* ====================| Benchmarks |==================== */
+
+static int
+bench_updaters(Report *r, SpriteAtlas *atlas, pgSurfaceObject *dest,
+               SIMDLevel level)
+{
+    BenchCase bc;
+
+    for (int v = 0; v < ARRAY_LEN(updater_variants); v++) {
+        for (int c = 0; c < ARRAY_LEN(particle_counts); c++) {
+            if (!setup_case(&bc, &updater_variants[v], particle_counts[c], 1, atlas,
+                            dest))
+                return 0;
+
+            bench_case(r, updater_variants[v].name, run_updater, &bc, level, 0);
+            dealloc_data_block(&bc.block);
+        }
+    }
+
+    for (int c = 0; c < ARRAY_LEN(particle_counts); c++) {
+        if (!setup_case(&bc, &updater_variants[0], particle_counts[c], 1, atlas,
+                        dest))
+            return 0;
+
+        bench_case(r, "calculate_surface_index_occurrences", run_index_occurrences,
+                   &bc, level, 0);
+        dealloc_data_block(&bc.block);
+    }
+
+    return 1;
+}
+
+static int
+bench_draw(Report *r, pgSurfaceObject *dest, SIMDLevel level)
+{
+    BenchCase bc;
+
+    for (int s = 0; s < ARRAY_LEN(sprite_sizes); s++) {
+        const int sprite = sprite_sizes[s];
+
+        SpriteAtlas *atlas = make_atlas(sprite);
+        if (!atlas)
+            return 0;
+
+        for (int c = 0; c < ARRAY_LEN(particle_counts); c++) {
+            if (!setup_case(&bc, &updater_variants[0], particle_counts[c], sprite,
+                            atlas, dest))
+                return 0;
+
+            /* Culling and blitcopy have no SIMD paths, time them once */
+            if (level == _SIMD_NONE) {
+                bench_case(r, "calculate_fragmentation_map", run_fragmentation_map,
+                           &bc, level, sprite);
+                bench_case(r, "blit_fragments_blitcopy", run_blit_blitcopy, &bc,
+                           level, sprite);
+            }
+
+            calculate_fragmentation_map(dest, &bc.block, &draw_ctx);
+            bench_case(r, "blit_fragments_add", run_blit_add, &bc, level, sprite);
+
+            bench_case(r, "stream_add", run_stream, &bc, level, sprite);
+
+            /* Like blitcopy, the streamed copy has no SIMD path */
+            if (level == _SIMD_NONE) {
+                bc.block.blend_mode = 0;
+                bench_case(r, "stream_blitcopy", run_stream, &bc, level, sprite);
+                bc.block.blend_mode = 1;
+            }
+
+            dealloc_data_block(&bc.block);
+        }
+
+        sprite_atlas_decref(atlas);
+    }
+
+    /* Streaks don't depend on the sprite size, speeds up to 2 make them up to
+     * 8 pixels long */
+    SpriteAtlas *atlas = make_atlas(1);
+    if (!atlas)
+        return 0;
+
+    for (int c = 0; c < ARRAY_LEN(particle_counts); c++) {
+        if (!setup_case(&bc, &updater_variants[0], particle_counts[c], 1, atlas,
+                        dest))
+            return 0;
+
+        bc.block.streak = 4.0f;
+        bench_case(r, "draw_streaks", run_stream, &bc, level, 0);
+        dealloc_data_block(&bc.block);
+    }
+
+    sprite_atlas_decref(atlas);
+
+    return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+    Report r = {.out = stdout, .entries = 0};
+
+    if (argc > 1) {
+        r.out = fopen(argv[1], "w");
+        if (!r.out) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    Py_Initialize();
+
+    pgSurfaceObject *dest = make_surface(DEST_WIDTH, DEST_HEIGHT, 0xFF000000u);
+    SpriteAtlas *atlas = make_atlas(1);
+    if (!dest || !atlas) {
+        fprintf(stderr, "Failed to create the benchmark surfaces\n");
+        return 1;
+    }
+
+    fprintf(r.out, "{\n  \"dest\": [%d, %d],\n  \"benchmarks\": [", DEST_WIDTH,
+            DEST_HEIGHT);
+
+    int ok = 1;
+    for (int level = _SIMD_NONE; ok && level <= _SIMD_AVX2; level++) {
+        if (!simd_level_supported((SIMDLevel)level))
+            continue;
+
+        ok = bench_updaters(&r, atlas, dest, (SIMDLevel)level) &&
+             bench_draw(&r, dest, (SIMDLevel)level);
+    }
+
+    fprintf(r.out, "\n  ]\n}\n");
+
+    if (!ok) {
+        PyErr_Print();
+        fprintf(stderr, "Benchmark setup failed\n");
+    }
+
+    sprite_atlas_decref(atlas);
+    free_surface(dest);
+    scratch_arena_free(&scratch);
+
+    if (r.out != stdout)
+        fclose(r.out);
+
+    Py_FinalizeEx();
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+"""Headless scenario benchmarks for ParticleManager.
+
+Every scenario starts from BASELINE and changes a single axis, so each number
+can be read against the baseline one. Spawn, update and draw are timed as
+separate benchmarks, all against an off-screen surface with the SDL dummy video
+driver, so the suite runs anywhere, CI included.
+
+Requires pyperf (``pip install pyperf``):
+
+    python bench/bench_scenarios.py -o scenarios.json
+    python bench/bench_scenarios.py --fast --axis sprite --axis blend
+    python -m pyperf compare_to before.json after.json
+"""
+
+import os
+
+os.environ.setdefault("SDL_VIDEODRIVER", "dummy")
+
+from time import perf_counter
+
+import pygame
+import pyperf
+from itz_particle_manager import EMIT_POINT, Emitter, ParticleEffect, ParticleManager
+
+SEED = 5489
+DEST_SIZE = (1280, 720)
+OFFSCREEN_POS = (-10_000, -10_000)
+
+# dt used when timing updates, small enough for the particles not to drift
+# noticeably (or die) over the many loops pyperf runs
+UPDATE_DT = 0.001
+
+BASELINE = {
+    "burst": 1000,  # particles per emitter
+    "emitters": 1,  # emitters per ParticleEffect
+    "blend": pygame.BLEND_ADD,
+    "sprite": 4,  # sprite side in pixels
+    "offscreen": 0.0,  # fraction of the instances spawned off the surface
+    "instances": 10,  # concurrent effect instances
+}
+
+AXES = {
+    "burst": (100, 1000, 10_000, 50_000),
+    "emitters": (1, 2, 4, 8),
+    "blend": (0, pygame.BLEND_ADD),
+    "sprite": (1, 2, 3, 4, 8, 16),
+    "offscreen": (0.0, 0.5, 0.9, 1.0),
+    "instances": (1, 10, 50, 200),
+}
+
+BLEND_NAMES = {0: "blitcopy", pygame.BLEND_ADD: "add"}
+
+
+def scenarios(axes):
+    """Yields (name, scenario) pairs, the baseline first and once only."""
+    yield "baseline", dict(BASELINE)
+
+    for axis in axes:
+        for value in AXES[axis]:
+            if value == BASELINE[axis]:
+                continue
+
+            label = BLEND_NAMES[value] if axis == "blend" else value
+            yield f"{axis}={label}", dict(BASELINE, **{axis: value})
+
+
+def make_effect(sc):
+    frames = tuple(
+        pygame.Surface((sc["sprite"], sc["sprite"]), 0, 32) for _ in range(4)
+    )
+    for i, frame in enumerate(frames):
+        frame.fill((60 * i + 40, 80, 200 - 40 * i))
+
+    emitters = tuple(
+        Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=sc["burst"],
+            animation=frames,
+            particle_lifetime=(1e6, 2e6),
+            speed_x=(-200, 200),
+            speed_y=(-200, 200),
+            blend_mode=sc["blend"],
+        )
+        for _ in range(sc["emitters"])
+    )
+
+    return ParticleEffect(emitters, seed=SEED)
+
+
+def spawn_positions(sc):
+    """Instances on a grid over the surface, the first ones pushed off it."""
+    count = sc["instances"]
+    offscreen = round(sc["offscreen"] * count)
+    w, h = DEST_SIZE
+
+    positions = []
+    for i in range(count):
+        if i < offscreen:
+            positions.append(OFFSCREEN_POS)
+        else:
+            positions.append(((i * 397) % w, (i * 211) % h))
+
+    return positions
+
+
+def spawned_manager(sc):
+    effect = make_effect(sc)
+    pm = ParticleManager(seed=SEED)
+    for pos in spawn_positions(sc):
+        pm.spawn_effect(effect, pos)
+
+    # spread the particles around their spawn points
+    pm.update(1.0)
+
+    return pm
+
+
+def time_spawn(loops, sc):
+    effect = make_effect(sc)
+    positions = spawn_positions(sc)
+    elapsed = 0.0
+
+    for _ in range(loops):
+        pm = ParticleManager(seed=SEED)
+
+        t0 = perf_counter()
+        for pos in positions:
+            pm.spawn_effect(effect, pos)
+        elapsed += perf_counter() - t0
+
+    return elapsed
+
+
+def time_update(loops, sc):
+    pm = spawned_manager(sc)
+
+    t0 = perf_counter()
+    for _ in range(loops):
+        pm.update(UPDATE_DT)
+
+    return perf_counter() - t0
+
+
+def time_draw(loops, sc):
+    pm = spawned_manager(sc)
+    dest = pygame.Surface(DEST_SIZE, 0, 32)
+
+    t0 = perf_counter()
+    for _ in range(loops):
+        pm.draw(dest)
+
+    return perf_counter() - t0
+
+
+PHASES = (("spawn", time_spawn), ("update", time_update), ("draw", time_draw))
+
+
+def add_cmdline_args(cmd, args):
+    for axis in args.axis or ():
+        cmd.extend(("--axis", axis))
+
+
+def main():
+    runner = pyperf.Runner(add_cmdline_args=add_cmdline_args)
+    runner.metadata["description"] = "ParticleManager scenario matrix"
+    runner.argparser.add_argument(
+        "--axis",
+        action="append",
+        choices=sorted(AXES),
+        help="only vary these axes (default: all of them)",
+    )
+    args = runner.parse_args()
+
+    pygame.init()
+
+    for name, sc in scenarios(args.axis or AXES):
+        for phase, func in PHASES:
+            runner.bench_time_func(f"{phase}[{name}]", func, sc)
+
+
+if __name__ == "__main__":
+    main()
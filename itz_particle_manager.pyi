@@ -1,4 +1,5 @@
-from typing import Sequence, Union, Tuple, overload
+import os
+from typing import Dict, Optional, Sequence, Union, Tuple, overload
 
 import pygame
 
@@ -6,6 +7,16 @@ Coord = Union[Sequence[float], Sequence[int]]
 FloatOrRange = Union[float, Sequence[float]]
 
 EMIT_POINT: int = 0
+FALLOFF_LINEAR: int = 0
+FALLOFF_INVERSE_SQUARE: int = 1
+COLLISION_BOUNCE: int = 0
+COLLISION_KILL: int = 1
+SIMD_NONE: int = 0
+SIMD_SSE2: int = 1
+SIMD_AVX2: int = 2
+
+def set_simd_level(level: int) -> None: ...
+def get_simd_level() -> int: ...
 
 class Emitter:
     @overload
@@ -20,17 +31,82 @@ class Emitter:
         acceleration_x: FloatOrRange = 0,
         acceleration_y: FloatOrRange = 0,
         blend_mode: int = pygame.BLEND_ADD,
+        noise_strength: float = 0.0,
+        noise_frequency: float = 0.05,
+        noise_scroll: float = 0.0,
+        compact: bool = False,
+        # p + v*t + a*t*t/2 exactly, integrated emitters step v += a*dt then
+        # p += v*dt and so run a*t*dt/2 ahead of it under acceleration
+        analytic: bool = False,
+        angle: FloatOrRange = 0,
+        angular_velocity: FloatOrRange = 0,
+        scale: FloatOrRange = 1,
+        rotation_steps: int = 32,
+        scale_steps: int = 8,
+        streak: float = 0.0,
     ) -> None: ...
 
 class ParticleEffect:
-    def __init__(self, emitters: Tuple[Emitter]) -> None: ...
+    def __init__(
+        self,
+        emitters: Tuple[Emitter],
+        bounds: Optional[Sequence[float]] = None,
+        restitution: float = 0.5,
+        friction: float = 0.0,
+        on_collision: int = COLLISION_BOUNCE,
+        seed: Optional[int] = None,
+    ) -> None: ...
 
 class ParticleManager:
     @property
     def num_particles(self) -> int: ...
-    def __init__(self) -> None: ...
+    @property
+    def max_attractors(self) -> int: ...
+    @max_attractors.setter
+    def max_attractors(self, value: int) -> None: ...
+    @property
+    def profiling(self) -> bool: ...
+    @profiling.setter
+    def profiling(self, value: bool) -> None: ...
+    @property
+    def fixed_timestep(self) -> float: ...
+    @fixed_timestep.setter
+    def fixed_timestep(self, value: float) -> None: ...
+    def __init__(self, seed: Optional[int] = None) -> None: ...
     def spawn_effect(
         self, effect: ParticleEffect, position: Sequence[float]
     ) -> None: ...
     def update(self, dt: float) -> None: ...
     def draw(self, surf: pygame.Surface) -> None: ...
+    def update_and_draw(self, dt: float, surf: pygame.Surface) -> None: ...
+    def add_attractor(
+        self,
+        pos: Sequence[float],
+        strength: float,
+        radius: float,
+        falloff: int = FALLOFF_INVERSE_SQUARE,
+    ) -> None: ...
+    def clear_attractors(self) -> None: ...
+    def set_collision_map(
+        self,
+        grid: Union[pygame.mask.Mask, bytes, bytearray, memoryview],
+        cell_size: float = 1.0,
+        size: Optional[Sequence[int]] = None,
+        bits: int = 8,
+        on_collision: int = COLLISION_BOUNCE,
+        restitution: float = 0.5,
+    ) -> None: ...
+    def clear_collision_map(self) -> None: ...
+    def set_budget(self, max_particles: int = 0, max_draw_ns: int = 0) -> None: ...
+    def stats(self) -> Dict[str, int]: ...
+    def start_trace(self, path: Union[str, bytes, os.PathLike]) -> None: ...
+    def stop_trace(self) -> None: ...
+
+class ParticleSystem:
+    @property
+    def workers(self) -> int: ...
+    def __init__(
+        self, workers: Optional[int] = None, seed: Optional[int] = None
+    ) -> None: ...
+    def create_manager(self) -> ParticleManager: ...
+    def update(self, dt: float) -> None: ...
@@ -8,22 +8,30 @@
 
 /* ====================| Public facing DataBlock functions |==================== */
 int
-init_data_block(DataBlock *block, Emitter *emitter, vec2 position)
+init_data_block(DataBlock *block, Emitter *emitter, vec2 position, MTState *rng)
 {
     block->particles_count = emitter->emission_number;
-    Py_INCREF(emitter->animation);
-    block->animation = emitter->animation;
+    sprite_atlas_incref(emitter->atlas);
+    block->atlas = emitter->atlas;
     block->num_frames = emitter->num_frames;
     block->blend_mode = emitter->blend_mode;
     block->ended = false;
+    block->compact = emitter->compact;
+    block->analytic = emitter->analytic;
+    block->noise = emitter->noise;
+    block->noise_offset = 0.0f;
+    block->age = 0.0f;
+    block->variants = emitter->variants;
+    if (block->variants)
+        sprite_variants_incref(block->variants);
+    block->streak = emitter->streak;
 
     /* Conditionally allocate memory for the arrays based on emitter properties */
     if (!alloc_and_init_positions(block, emitter, position) ||
-        !alloc_and_init_velocities(block, emitter) ||
-        !alloc_and_init_accelerations(block, emitter) ||
-        !alloc_and_init_lifetimes(block, emitter) ||
-        !alloc_and_init_animation_indices(block, emitter) ||
-        !init_fragmentation_map(block))
+        !alloc_and_init_velocities(block, emitter, rng) ||
+        !alloc_and_init_accelerations(block, emitter, rng) ||
+        !alloc_and_init_lifetimes(block, emitter, rng) ||
+        !alloc_and_init_transforms(block, emitter, rng))
         return 0;
 
     choose_and_set_update_function(block, emitter);
@@ -34,82 +42,237 @@ init_data_block(DataBlock *block, Emitter *emitter, vec2 position)
 void
 dealloc_data_block(DataBlock *block)
 {
-    Py_DECREF(block->animation);
+    sprite_atlas_decref(block->atlas);
+    sprite_variants_decref(block->variants);
     float_array_free(&block->positions_x);
     float_array_free(&block->positions_y);
     float_array_free(&block->velocities_x);
     float_array_free(&block->velocities_y);
     float_array_free(&block->accelerations_x);
     float_array_free(&block->accelerations_y);
-    float_array_free(&block->lifetimes);
+    half_array_free(&block->accelerations_x_h);
+    half_array_free(&block->accelerations_y_h);
     float_array_free(&block->max_lifetimes);
-    PyMem_Free(block->animation_indices);
-    dealloc_fragmentation_map(&block->frag_map);
+    float_array_free(&block->angles);
+    float_array_free(&block->angular_velocities);
+    float_array_free(&block->scales);
+}
+
+Py_ssize_t
+data_block_allocated_bytes(const DataBlock *block)
+{
+    const float_array *arrays[] = {
+        &block->positions_x,     &block->positions_y,     &block->velocities_x,
+        &block->velocities_y,    &block->accelerations_x, &block->accelerations_y,
+        &block->max_lifetimes,   &block->angles,          &block->angular_velocities,
+        &block->scales,
+    };
+
+    Py_ssize_t bytes = 0;
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+        bytes += arrays[i]->capacity * (Py_ssize_t)sizeof(float);
+
+    bytes += block->accelerations_x_h.capacity * (Py_ssize_t)sizeof(uint16_t);
+    bytes += block->accelerations_y_h.capacity * (Py_ssize_t)sizeof(uint16_t);
+
+    return bytes;
 }
 
 void
 choose_and_set_update_function(DataBlock *block, Emitter *emitter)
 {
-    const bool use_x_acc = emitter->acceleration_x.in_use;
-    const bool use_y_acc = emitter->acceleration_y.in_use;
+    int features = 0;
 
-#if !defined(__EMSCRIPTEN__)
-    if (_Has_AVX2()) {
-        if (!use_x_acc && !use_y_acc)
-            block->updater = update_with_no_acceleration_avx2;
-        else if (use_x_acc && !use_y_acc)
-            block->updater = update_with_acceleration_x_avx2;
-        else if (!use_x_acc && use_y_acc)
-            block->updater = update_with_acceleration_y_avx2;
-        else
-            block->updater = update_with_acceleration_avx2;
+    if (emitter->acceleration_x.in_use)
+        features |= _UPDATE_ACC_X;
+    if (emitter->acceleration_y.in_use)
+        features |= _UPDATE_ACC_Y;
+
+    /* Compact blocks only differ when they have accelerations to widen */
+    if (block->compact && features)
+        features |= _UPDATE_COMPACT;
 
+#if !defined(__EMSCRIPTEN__)
+    /* The AVX2 compact variants need F16C to widen the halves */
+    if (_Has_AVX2() && (ENABLE_F16C || !(features & _UPDATE_COMPACT))) {
+        block->updater = updaters_avx2[features];
         return;
     }
 
 #if ENABLE_SSE_NEON
     if (_HasSSE_NEON()) {
-        if (!use_x_acc && !use_y_acc)
-            block->updater = update_with_no_acceleration_sse2;
-        else if (use_x_acc && !use_y_acc)
-            block->updater = update_with_acceleration_x_sse2;
-        else if (!use_x_acc && use_y_acc)
-            block->updater = update_with_acceleration_y_sse2;
-        else
-            block->updater = update_with_acceleration_sse2;
-
+        block->updater = updaters_sse2[features];
         return;
     }
 #endif /* ENABLE_SSE_NEON */
 #endif /* __EMSCRIPTEN__ */
 
-    if (!use_x_acc && !use_y_acc)
-        block->updater = update_with_no_acceleration;
-    else if (use_x_acc && !use_y_acc)
-        block->updater = update_with_acceleration_x;
-    else if (!use_x_acc && use_y_acc)
-        block->updater = update_with_acceleration_y;
-    else
-        block->updater = update_with_acceleration;
+    block->updater = updaters_scalar[features];
+}
+
+static FORCEINLINE float
+acceleration_at(const float *acc, const uint16_t *acc_h, int i)
+{
+    if (acc)
+        return acc[i];
+
+    return acc_h ? half_to_float(acc_h[i]) : 0.0f;
+}
+
+static FORCEINLINE float
+velocity_at(const float *vel, int i)
+{
+    return vel ? vel[i] : 0.0f;
+}
+
+/* Moves particle i t ahead of its stored state and returns its velocity then.
+ * Analytic blocks use the closed form, the same expression as
+ * integrate_analytic_block(). The others take one semi-implicit Euler step like
+ * the updaters, so a lead of a whole substep lands where that substep will */
+static FORCEINLINE void
+project_particle(const DataBlock *block, int i, float t, float *x, float *y,
+                 float *vx, float *vy)
+{
+    const float ax = acceleration_at(block->accelerations_x.data,
+                                     block->accelerations_x_h.data, i);
+    const float ay = acceleration_at(block->accelerations_y.data,
+                                     block->accelerations_y_h.data, i);
+    const float vx0 = velocity_at(block->velocities_x.data, i);
+    const float vy0 = velocity_at(block->velocities_y.data, i);
+
+    *vx = vx0 + ax * t;
+    *vy = vy0 + ay * t;
+
+    if (block->analytic) {
+        const float half_t2 = 0.5f * t * t;
+        *x += vx0 * t + ax * half_t2;
+        *y += vy0 * t + ay * half_t2;
+    }
+    else {
+        *x += *vx * t;
+        *y += *vy * t;
+    }
+}
+
+/* Evaluates an analytic block at its age and stores the result, from there on
+ * the block integrates like any other one */
+static void
+integrate_analytic_block(DataBlock *block)
+{
+    float *restrict positions_x = block->positions_x.data;
+    float *restrict positions_y = block->positions_y.data;
+    float *restrict velocities_x = block->velocities_x.data;
+    float *restrict velocities_y = block->velocities_y.data;
+    const float *accelerations_x = block->accelerations_x.data;
+    const float *accelerations_y = block->accelerations_y.data;
+    const uint16_t *accelerations_x_h = block->accelerations_x_h.data;
+    const uint16_t *accelerations_y_h = block->accelerations_y_h.data;
+
+    const float t = block->age;
+    const float half_t2 = 0.5f * t * t;
+
+    /* A block at rest stays where it spawned */
+    if (!velocities_x) {
+        block->analytic = false;
+        return;
+    }
+
+    for (int i = 0; i < block->particles_count; i++) {
+        const float ax = acceleration_at(accelerations_x, accelerations_x_h, i);
+        const float ay = acceleration_at(accelerations_y, accelerations_y_h, i);
+
+        positions_x[i] += velocities_x[i] * t + ax * half_t2;
+        positions_y[i] += velocities_y[i] * t + ay * half_t2;
+        velocities_x[i] += ax * t;
+        velocities_y[i] += ay * t;
+    }
+
+    block->analytic = false;
 }
 
 void
-update_data_block(DataBlock *block, float dt)
+update_data_block(DataBlock *block, float dt, const UpdateContext *ctx)
 {
-    block->updater(block, dt);
+    Profiler *prof = ctx->prof;
+    uint64_t t0 = prof_begin(prof);
+
+    /* The closed form only holds under constant acceleration, anything that
+     * pushes particles around or reads their positions needs them stored */
+    if (block->analytic && (ctx->attractors_count || ctx->grid ||
+                            block->noise.strength != 0.0f || block->bounds.in_use))
+        integrate_analytic_block(block);
+
+    if (ctx->attractors_count)
+        apply_attractors(block, ctx->attractors, ctx->attractors_count, dt);
+
+    if (block->noise.strength != 0.0f) {
+        apply_noise(block, dt);
+        block->noise_offset =
+            fmodf(block->noise_offset + block->noise.scroll * dt, NOISE_LATTICE_SIZE);
+    }
+
+    prof_end(prof, _PHASE_FORCES, t0);
+    t0 = prof_begin(prof);
+
+    /* Analytic blocks only need their clock advanced, as do blocks at rest */
+    if (!block->analytic && block->velocities_x.data)
+        block->updater(block, dt);
+    block->age += dt;
+
+    prof_end(prof, _PHASE_UPDATE, t0);
+    t0 = prof_begin(prof);
+
+    /* A kill response reports the first particle it hit, everything before it
+     * survived so the squeeze starts from there */
+    if (block->bounds.in_use) {
+        const int first = collide_bounds(block, &block->bounds);
+        if (first >= 0)
+            remove_killed_particles(block, first, &block->bounds, NULL);
+    }
+    if (ctx->grid) {
+        const int first = collide_grid(block, ctx->grid, dt);
+        if (first >= 0)
+            remove_killed_particles(block, first, NULL, ctx->grid);
+    }
+
+    prof_end(prof, _PHASE_COLLISIONS, t0);
+    t0 = prof_begin(prof);
+
+    if (prof)
+        prof->particles_updated += block->particles_count;
 
     recalculate_particle_count(block);
+
+    prof_end(prof, _PHASE_PARTICLE_COUNT, t0);
 }
 
 int
-draw_data_block(DataBlock *block, pgSurfaceObject *dest, const int blend_flag)
+draw_data_block(DataBlock *block, pgSurfaceObject *dest, const int blend_flag,
+                const DrawContext *ctx)
 {
-    update_indices(block);
+    Profiler *prof = ctx->prof;
 
-    if (!calculate_fragmentation_map(dest, block))
+    if (!calculate_fragmentation_map(dest, block, ctx))
         return 0;
 
-    blit_fragments(dest, &block->frag_map, block, blend_flag);
+    /* A streamed map was blitted as it was built, there's nothing left */
+    if (ctx->materialize) {
+        uint64_t t0 = prof_begin(prof);
+        trace_begin(ctx->tracer, "blit_fragments", -1);
+
+        blit_fragments(dest, &block->frag_map, block, blend_flag);
+
+        trace_end(ctx->tracer, "blit_fragments");
+        prof_end(prof, _PHASE_BLIT, t0);
+    }
+
+    if (prof) {
+        const FragmentationMap *frag_map = &block->frag_map;
+        prof->pixels_blended += frag_map->streamed_pixels;
+        for (int i = 0; i < frag_map->dest_count; i++)
+            prof->pixels_blended += (int64_t)frag_map->destinations[i].width *
+                                    frag_map->destinations[i].rows;
+    }
 
     return 1;
 }
@@ -119,49 +282,53 @@ draw_data_block(DataBlock *block, pgSurfaceObject *dest, const int blend_flag)
 void
 calculate_surface_index_occurrences(DataBlock *block)
 {
-    block->frag_map.used_f = 0;
-
-    int const *indices = block->animation_indices;
-    int particle_count = block->particles_count;
-
-    int current_value = indices[0];
-    int current_count = 1;
-
     FragmentationMap *frag_map = &block->frag_map;
     Fragment *fragments = frag_map->fragments;
+    int *starts = frag_map->frame_starts;
+    const int num_frames = block->num_frames;
 
-    for (int i = 1; i < particle_count; ++i) {
-        if (indices[i] == current_value)
-            current_count++;
-        else {
-            Fragment *fragment = &fragments[frag_map->used_f++];
-            fragment->animation_index =
-                clamp_int(current_value, 0, block->num_frames - 1);
-            fragment->length = current_count;
+    /* Particles are bucketed by frame thanks to the max lifetimes being sorted
+     * at spawn and sharing the block's age, so only the bucket boundaries are
+     * needed. Particles past the last frame stay in the last bucket */
+    starts[0] = 0;
+    starts[num_frames] = block->particles_count;
+    find_frame_boundaries(block, starts);
 
-            current_value = indices[i];
-            current_count = 1;
-        }
-    }
+    frag_map->used_f = 0;
+
+    for (int k = 0; k < num_frames; k++) {
+        const int length = starts[k + 1] - starts[k];
+        if (!length)
+            continue;
 
-    if (current_count > 0) {
         Fragment *fragment = &fragments[frag_map->used_f++];
-        fragment->animation_index =
-            clamp_int(current_value, 0, block->num_frames - 1);
-        fragment->length = current_count;
+        fragment->animation_index = k;
+        fragment->length = length;
     }
 }
 
 int
-populate_destinations_array(pgSurfaceObject *dest, DataBlock *block)
+populate_destinations_array(pgSurfaceObject *dest, DataBlock *block, float lead,
+                            int stride, SpriteBlitter blit)
 {
     FragmentationMap *frag_map = &block->frag_map;
     Fragment *fragments = frag_map->fragments;
 
     BlitDestination *destinations = frag_map->destinations;
-    float *positions_x = block->positions_x.data;
-    float *positions_y = block->positions_y.data;
-    PyObject **animation = PySequence_Fast_ITEMS(block->animation);
+    const float *positions_x = block->positions_x.data;
+    const float *positions_y = block->positions_y.data;
+    /* Analytic blocks are evaluated at their age, the others are projected
+     * from their stored state by the lead time */
+    const bool project = block->analytic || lead != 0.0f;
+    const float t = block->analytic ? block->age + lead : lead;
+    const SpriteAtlas *atlas = block->atlas;
+    SpriteVariants *variants = block->variants;
+    const SpriteAtlas *blit_atlas = block_blit_atlas(block);
+    const int src_pitch = blit_atlas->pitch;
+    const float *angles = block->angles.data;
+    const float *angular_velocities = block->angular_velocities.data;
+    const float *scales = block->scales.data;
+    const float spin_t = block->age + lead;
     SDL_Surface *dest_surf = dest->surf;
 
     const int dest_skip = dest_surf->pitch / 4;
@@ -176,62 +343,364 @@ populate_destinations_array(pgSurfaceObject *dest, DataBlock *block)
 
     frag_map->dest_count = 0;
 
+    int start = 0;
+
     for (int i = 0; i < frag_map->used_f; i++) {
         Fragment *frg = &fragments[i];
-        int length = frg->length;
-        const pgSurfaceObject *src_obj =
-            (pgSurfaceObject *)animation[frg->animation_index];
-        if (!src_obj) {
-            PyErr_SetString(PyExc_RuntimeError, "Surface is not initialized");
-            return 0;
-        }
+        const int end = start + frg->length;
+        const AtlasFrame *frame = &atlas->frames[frg->animation_index];
+
+        /* Only the particles at a multiple of the stride are drawn, so a
+         * decimated draw always keeps the same subset */
+        int p = (start + stride - 1) / stride * stride;
+        start = end;
+        frg->length = 0;
+
+        for (; p < end; p += stride) {
+            float x = positions_x[p];
+            float y = positions_y[p];
+
+            if (project) {
+                float vx, vy;
+                project_particle(block, p, t, &x, &y, &vx, &vy);
+            }
 
-        SDL_Surface const *src_surf = src_obj->surf;
-        const int src_pitch = src_surf->pitch / 4;
-        const int width = src_surf->w;
-        const int height = src_surf->h;
+            int A_x = (int)x;
+            int A_y = (int)y;
+            int width = frame->width;
+            int height = frame->height;
+            const uint32_t *src_pixels = atlas_frame_pixels(atlas, frg->animation_index);
+
+            /* Rotated and scaled sprites keep the center of the frame */
+            if (variants) {
+                const float angle =
+                    (angles ? angles[p] : block->angle) +
+                    (angular_velocities ? angular_velocities[p]
+                                        : block->angular_velocity) *
+                        spin_t;
+                const float scale = scales ? scales[p] : block->scale;
+                const int slot =
+                    sprite_variant_slot(variants, frg->animation_index, angle, scale);
+                const AtlasFrame *variant = &blit_atlas->frames[slot];
+
+                A_x += variants->slots[slot].dx;
+                A_y += variants->slots[slot].dy;
+                width = variant->width;
+                height = variant->height;
+                src_pixels = sprite_variant_pixels(variants, slot);
+                if (!src_pixels)
+                    return 0;
+            }
 
-        for (int j = 0; j < length; j++) {
-            const int A_x = (int)positions_x[j];
-            const int A_y = (int)positions_y[j];
             const int A_x_right = A_x + width;
             const int A_y_bottom = A_y + height;
 
+            /* Most sprites land fully inside, those skip the clipping */
+            if (blit && A_x >= dst_clip_x && A_x_right <= dst_clip_right &&
+                A_y >= dst_clip_y && A_y_bottom <= dst_clip_bottom) {
+                blit(blit_atlas, src_pixels, dest_pixels + A_y * dest_skip + A_x,
+                     width, height, dest_skip);
+                frag_map->streamed++;
+                frag_map->streamed_pixels += width * height;
+                continue;
+            }
+
             SDL_Rect clipped;
             if (!IntersectRect(A_x, A_x_right, dst_clip_x, dst_clip_right, A_y,
-                               A_y_bottom, dst_clip_y, dst_clip_bottom, &clipped)) {
-                frg->length--;
+                               A_y_bottom, dst_clip_y, dst_clip_bottom, &clipped))
+                continue;
+
+            uint32_t *pixels = dest_pixels + clipped.y * dest_skip + clipped.x;
+            const int src_offset = (A_x < dst_clip_x ? dst_clip_x - A_x : 0) +
+                                   (A_y < dst_clip_y ? dst_clip_y - A_y : 0) * src_pitch;
+
+            /* Clipped ones are blitted in place too rather than recorded, so
+             * overlapping sprites keep the order a recorded map blits them in */
+            if (blit) {
+                blit(blit_atlas, src_pixels + src_offset, pixels, clipped.w,
+                     clipped.h, dest_skip);
+                frag_map->streamed++;
+                frag_map->streamed_pixels += clipped.w * clipped.h;
                 continue;
             }
 
             BlitDestination *destination = &destinations[frag_map->dest_count++];
+            frg->length++;
 
-            destination->pixels = dest_pixels + clipped.y * dest_skip + clipped.x;
+            destination->pixels = pixels;
             destination->width = clipped.w;
             destination->rows = clipped.h;
-            destination->src_offset =
-                (A_x < dst_clip_x ? dst_clip_x - A_x : 0) +
-                (A_y < dst_clip_y ? dst_clip_y - A_y : 0) * src_pitch;
+            destination->src = src_pixels + src_offset;
         }
+    }
 
-        positions_x += length;
-        positions_y += length;
+    return 1;
+}
+
+/* Far enough to be off any surface while the fixed point math stays exact */
+#define STREAK_LIMIT 16777216.0f
+
+static FORCEINLINE int64_t
+to_fixed(float v)
+{
+    return (int64_t)floorf(MIN(MAX(v, -STREAK_LIMIT), STREAK_LIMIT) * 65536.0f);
+}
+
+/* Rounds towards negative infinity, b must be positive */
+static FORCEINLINE int64_t
+floor_div(int64_t a, int64_t b)
+{
+    const int64_t q = a / b;
+    return (a % b < 0) ? q - 1 : q;
+}
+
+static FORCEINLINE int64_t
+ceil_div(int64_t a, int64_t b)
+{
+    return -floor_div(-a, b);
+}
+
+/* Narrows [k0, k1] down to the steps whose pixel lands in [lo, hi) on one
+ * axis, the pixel of step k being at origin + k * step */
+static FORCEINLINE void
+clip_streak_axis(int64_t origin, int64_t step, int lo, int hi, int64_t *k0,
+                 int64_t *k1)
+{
+    const int64_t min = (int64_t)lo << 16;
+    const int64_t max = ((int64_t)hi << 16) - 1;
+
+    if (step > 0) {
+        *k0 = MAX(*k0, ceil_div(min - origin, step));
+        *k1 = MIN(*k1, floor_div(max - origin, step));
+    }
+    else if (step < 0) {
+        *k0 = MAX(*k0, ceil_div(origin - max, -step));
+        *k1 = MIN(*k1, floor_div(origin - min, -step));
+    }
+    else if (origin < min || origin > max) {
+        *k1 = -1;
+    }
+}
+
+/* Every particle is drawn as a line from its position back along its velocity,
+ * in the average color of its frame. The line is walked one pixel at a time on
+ * its longer axis and clipped exactly beforehand, so the rasterizers never
+ * check bounds */
+int
+populate_streaks(pgSurfaceObject *dest, DataBlock *block, float lead, int stride,
+                 StreakRasterizer draw)
+{
+    FragmentationMap *frag_map = &block->frag_map;
+    const Fragment *fragments = frag_map->fragments;
+
+    const float *positions_x = block->positions_x.data;
+    const float *positions_y = block->positions_y.data;
+    const float *velocities_x = block->velocities_x.data;
+    const float *velocities_y = block->velocities_y.data;
+    /* Same projection as populate_destinations_array(), the velocity is
+     * projected along with the position */
+    const bool project = block->analytic || lead != 0.0f;
+    const float t = block->analytic ? block->age + lead : lead;
+    const float length = block->streak;
+    const SpriteAtlas *atlas = block->atlas;
+    SDL_Surface *dest_surf = dest->surf;
+
+    const int dest_skip = dest_surf->pitch / 4;
+    uint32_t *dest_pixels = (uint32_t *)dest_surf->pixels;
+
+    /* Pixels past 32767 don't fit the fixed point coordinates */
+    const SDL_Rect dest_clip = dest_surf->clip_rect;
+    const int clip_right = MIN(dest_clip.x + dest_clip.w, INT16_MAX);
+    const int clip_bottom = MIN(dest_clip.y + dest_clip.h, INT16_MAX);
+
+    frag_map->dest_count = 0;
+    if (!draw)
+        return 1;
+
+    int start = 0;
+
+    for (int i = 0; i < frag_map->used_f; i++) {
+        const Fragment *frg = &fragments[i];
+        const int end = start + frg->length;
+
+        Streak streak;
+        streak.color = atlas->frames[frg->animation_index].average;
+
+        int p = (start + stride - 1) / stride * stride;
+        start = end;
+
+        for (; p < end; p += stride) {
+            float x = positions_x[p];
+            float y = positions_y[p];
+            float vx = velocity_at(velocities_x, p);
+            float vy = velocity_at(velocities_y, p);
+
+            if (project)
+                project_particle(block, p, t, &x, &y, &vx, &vy);
+
+            /* A slow particle still gets its head pixel */
+            const float dx = MIN(MAX(-vx * length, -STREAK_LIMIT), STREAK_LIMIT);
+            const float dy = MIN(MAX(-vy * length, -STREAK_LIMIT), STREAK_LIMIT);
+            const float major = MAX(fabsf(dx), fabsf(dy));
+            const bool moving = major >= 1.0f;
+
+            const int64_t origin_x = to_fixed(x), origin_y = to_fixed(y);
+            const int64_t step_x = moving ? (int64_t)(dx / major * 65536.0f) : 0;
+            const int64_t step_y = moving ? (int64_t)(dy / major * 65536.0f) : 0;
+
+            int64_t k0 = 0, k1 = moving ? (int64_t)major : 0;
+
+            /* Most streaks land fully inside, with both ends in the clip rect
+             * the pixels between are too and the divisions can be skipped */
+            const int64_t end_x = (origin_x + k1 * step_x) >> 16;
+            const int64_t end_y = (origin_y + k1 * step_y) >> 16;
+            if (!(MIN(origin_x >> 16, end_x) >= dest_clip.x &&
+                  MAX(origin_x >> 16, end_x) < clip_right &&
+                  MIN(origin_y >> 16, end_y) >= dest_clip.y &&
+                  MAX(origin_y >> 16, end_y) < clip_bottom)) {
+                clip_streak_axis(origin_x, step_x, dest_clip.x, clip_right, &k0, &k1);
+                clip_streak_axis(origin_y, step_y, dest_clip.y, clip_bottom, &k0, &k1);
+                if (k0 > k1)
+                    continue;
+            }
+
+            /* Inside the clip rect, so these fit */
+            streak.x = (int32_t)(origin_x + k0 * step_x);
+            streak.y = (int32_t)(origin_y + k0 * step_y);
+            streak.step_x = (int32_t)step_x;
+            streak.step_y = (int32_t)step_y;
+            streak.count = (int)(k1 - k0 + 1);
+
+            draw(atlas, &streak, dest_pixels, dest_skip);
+            frag_map->streamed++;
+            frag_map->streamed_pixels += streak.count;
+        }
     }
 
     return 1;
 }
 
 int
-calculate_fragmentation_map(pgSurfaceObject *dest, DataBlock *block)
+calculate_fragmentation_map(pgSurfaceObject *dest, DataBlock *block,
+                            const DrawContext *ctx)
 {
+    Profiler *prof = ctx->prof;
+
+    const size_t scratch_capacity = ctx->scratch->capacity;
+    if (!prepare_fragmentation_map(block, ctx->scratch, ctx->materialize))
+        return 0;
+
+    if (prof)
+        prof->bytes_allocated += (int64_t)(ctx->scratch->capacity - scratch_capacity);
+
+    uint64_t t0 = prof_begin(prof);
+
     calculate_surface_index_occurrences(block);
 
-    if (!populate_destinations_array(dest, block))
+    prof_end(prof, _PHASE_OCCURRENCES, t0);
+
+    /* Streamed sprites and streaks are drawn while the map is built, so that
+     * loop is the blit phase. Only a materialized map times its destinations
+     * apart from the blit that follows */
+    const bool streaming = !ctx->materialize || block->streak > 0.0f;
+    const ProfilerPhase phase = streaming ? _PHASE_BLIT : _PHASE_DESTINATIONS;
+    int ok;
+
+    t0 = prof_begin(prof);
+    if (streaming)
+        trace_begin(ctx->tracer, "blit_fragments", -1);
+
+    /* Streaks have no sprite to record, they're drawn in place either way */
+    if (block->streak > 0.0f) {
+        StreakRasterizer draw =
+            choose_streak_rasterizer(block->blend_mode, dest->surf->pitch / 4);
+        ok = populate_streaks(dest, block, ctx->lead_time, ctx->stride, draw);
+    }
+    else {
+        SpriteBlitter blit =
+            ctx->materialize ? NULL : choose_sprite_blitter(block->blend_mode);
+        ok = populate_destinations_array(dest, block, ctx->lead_time, ctx->stride,
+                                         blit);
+    }
+
+    if (streaming)
+        trace_end(ctx->tracer, "blit_fragments");
+    prof_end(prof, phase, t0);
+
+    if (!ok)
         return 0;
 
+    if (prof) {
+        const int sampled = (block->particles_count + ctx->stride - 1) / ctx->stride;
+        const int drawn = block->frag_map.dest_count + block->frag_map.streamed;
+        prof->destinations += drawn;
+        prof->particles_culled += sampled - drawn;
+        prof->particles_decimated += block->particles_count - sampled;
+    }
+
     return 1;
 }
 
+/* Per sprite kernel matching blit_fragments(), NULL if the mode draws nothing */
+SpriteBlitter
+choose_sprite_blitter(int blend_flag)
+{
+    switch (blend_flag) {
+        case 0: /* blitcopy */
+            return blit_sprite_copy;
+        case 1: /* add */
+#if !defined(__EMSCRIPTEN__)
+            if (_Has_AVX2())
+                return blit_sprite_add_avx2;
+#if ENABLE_SSE_NEON
+            if (_HasSSE_NEON())
+                return blit_sprite_add_sse2;
+#endif /* ENABLE_SSE_NEON */
+#endif /* __EMSCRIPTEN__ */
+            return blit_sprite_add_scalar;
+        default:
+            return NULL;
+    }
+}
+
+/* Per streak kernel for the blend mode, NULL if the mode draws nothing. The
+ * vector kernels pack row and column into 16 bits each */
+StreakRasterizer
+choose_streak_rasterizer(int blend_flag, int pitch)
+{
+    switch (blend_flag) {
+        case 0: /* blitcopy */
+            return draw_streak_copy;
+        case 1: /* add */
+            if (pitch > INT16_MAX)
+                return draw_streak_add_scalar;
+#if !defined(__EMSCRIPTEN__)
+            if (_Has_AVX2())
+                return draw_streak_add_avx2;
+#if ENABLE_SSE_NEON
+            if (_HasSSE_NEON())
+                return draw_streak_add_sse2;
+#endif /* ENABLE_SSE_NEON */
+#endif /* __EMSCRIPTEN__ */
+            return draw_streak_add_scalar;
+        default:
+            return NULL;
+    }
+}
+
+void
+draw_streak_copy(const SpriteAtlas *atlas, const Streak *streak, uint32_t *pixels,
+                 int pitch)
+{
+    int32_t x = streak->x, y = streak->y;
+
+    for (int k = 0; k < streak->count; k++) {
+        pixels[(y >> 16) * pitch + (x >> 16)] = streak->color;
+        x += streak->step_x;
+        y += streak->step_y;
+    }
+}
+
 void
 blit_fragments(pgSurfaceObject *dest, FragmentationMap *frag_map, DataBlock *block,
                int blend_flags)
@@ -248,110 +717,111 @@ blit_fragments(pgSurfaceObject *dest, FragmentationMap *frag_map, DataBlock *blo
     }
 }
 
+/* Copies one sprite of the atlas, dst_pitch is in pixels */
 void
-blit_fragments_blitcopy(FragmentationMap *frag_map, pgSurfaceObject *dest,
-                        DataBlock *block)
+blit_sprite_copy(const SpriteAtlas *atlas, const uint32_t *src, uint32_t *dst,
+                 int width, int rows, int dst_pitch)
 {
-    PyObject **animation = PySequence_Fast_ITEMS(block->animation);
-    Fragment *fragments = frag_map->fragments;
-    BlitDestination *destinations = frag_map->destinations;
-    const int dst_skip = dest->surf->pitch / 4;
+    const uint32_t *srcp32 = src;
+    uint32_t *dstp32 = dst;
+    const int src_skip = atlas->pitch;
+    const int dst_skip = dst_pitch;
 
-    for (int i = 0; i < frag_map->used_f; i++) {
-        Fragment *fragment = &fragments[i];
-        SDL_Surface *src_surf =
-            ((pgSurfaceObject *)animation[fragment->animation_index])->surf;
-        const int src_skip = src_surf->pitch / 4;
-        uint32_t *const src_start = (uint32_t *)src_surf->pixels;
-
-        for (int j = 0; j < fragment->length; j++) {
-            BlitDestination *item = &destinations[j];
-
-            uint32_t *srcp32 = src_start + item->src_offset;
-            uint32_t *dstp32 = item->pixels;
-
-            if (item->width == 1 && item->rows == 1) {
-                *dstp32 = *srcp32;
-                continue;
-            }
-            else if (item->width == 2 && item->rows == 2) {
-                dstp32[0] = srcp32[0];
-                dstp32[1] = srcp32[1];
+    if (width == 1 && rows == 1) {
+        *dstp32 = *srcp32;
+        return;
+    }
+    else if (width == 2 && rows == 2) {
+        dstp32[0] = srcp32[0];
+        dstp32[1] = srcp32[1];
 
-                srcp32 += src_skip;
-                dstp32 += dst_skip;
+        srcp32 += src_skip;
+        dstp32 += dst_skip;
 
-                dstp32[0] = srcp32[0];
-                dstp32[1] = srcp32[1];
+        dstp32[0] = srcp32[0];
+        dstp32[1] = srcp32[1];
 
-                continue;
-            }
-            else if (item->width == 3 && item->rows == 3) {
-                UNROLL_2({
-                    dstp32[0] = srcp32[0];
-                    dstp32[1] = srcp32[1];
-                    dstp32[2] = srcp32[2];
+        return;
+    }
+    else if (width == 3 && rows == 3) {
+        UNROLL_2({
+            dstp32[0] = srcp32[0];
+            dstp32[1] = srcp32[1];
+            dstp32[2] = srcp32[2];
 
-                    srcp32 += src_skip;
-                    dstp32 += dst_skip;
-                })
+            srcp32 += src_skip;
+            dstp32 += dst_skip;
+        })
 
-                dstp32[0] = srcp32[0];
-                dstp32[1] = srcp32[1];
-                dstp32[2] = srcp32[2];
+        dstp32[0] = srcp32[0];
+        dstp32[1] = srcp32[1];
+        dstp32[2] = srcp32[2];
 
-                continue;
-            }
-            else if (item->width == 4 && item->rows == 4) {
-                UNROLL_3({
-                    dstp32[0] = srcp32[0];
-                    dstp32[1] = srcp32[1];
-                    dstp32[2] = srcp32[2];
-                    dstp32[3] = srcp32[3];
-
-                    srcp32 += src_skip;
-                    dstp32 += dst_skip;
-                })
-
-                dstp32[0] = srcp32[0];
-                dstp32[1] = srcp32[1];
-                dstp32[2] = srcp32[2];
-                dstp32[3] = srcp32[3];
+        return;
+    }
+    else if (width == 4 && rows == 4) {
+        UNROLL_3({
+            dstp32[0] = srcp32[0];
+            dstp32[1] = srcp32[1];
+            dstp32[2] = srcp32[2];
+            dstp32[3] = srcp32[3];
+
+            srcp32 += src_skip;
+            dstp32 += dst_skip;
+        })
+
+        dstp32[0] = srcp32[0];
+        dstp32[1] = srcp32[1];
+        dstp32[2] = srcp32[2];
+        dstp32[3] = srcp32[3];
 
-                continue;
-            }
-            else if (item->width == 5 && item->rows == 5) {
-                UNROLL_4({
-                    dstp32[0] = srcp32[0];
-                    dstp32[1] = srcp32[1];
-                    dstp32[2] = srcp32[2];
-                    dstp32[3] = srcp32[3];
-                    dstp32[4] = srcp32[4];
-
-                    srcp32 += src_skip;
-                    dstp32 += dst_skip;
-                })
-
-                dstp32[0] = srcp32[0];
-                dstp32[1] = srcp32[1];
-                dstp32[2] = srcp32[2];
-                dstp32[3] = srcp32[3];
-                dstp32[4] = srcp32[4];
+        return;
+    }
+    else if (width == 5 && rows == 5) {
+        UNROLL_4({
+            dstp32[0] = srcp32[0];
+            dstp32[1] = srcp32[1];
+            dstp32[2] = srcp32[2];
+            dstp32[3] = srcp32[3];
+            dstp32[4] = srcp32[4];
+
+            srcp32 += src_skip;
+            dstp32 += dst_skip;
+        })
+
+        dstp32[0] = srcp32[0];
+        dstp32[1] = srcp32[1];
+        dstp32[2] = srcp32[2];
+        dstp32[3] = srcp32[3];
+        dstp32[4] = srcp32[4];
 
-                continue;
-            }
+        return;
+    }
 
-            int h = item->rows;
-            const int copy_w = item->width * 4;
+    int h = rows;
+    const int copy_w = width * 4;
 
-            while (h--) {
-                memcpy(dstp32, srcp32, copy_w);
-                srcp32 += src_skip;
-                dstp32 += dst_skip;
-            }
-        }
+    while (h--) {
+        memcpy(dstp32, srcp32, copy_w);
+        srcp32 += src_skip;
+        dstp32 += dst_skip;
+    }
+}
 
-        destinations += fragment->length;
+void
+blit_fragments_blitcopy(FragmentationMap *frag_map, pgSurfaceObject *dest,
+                        DataBlock *block)
+{
+    const SpriteAtlas *atlas = block_blit_atlas(block);
+    const int dst_skip = dest->surf->pitch / 4;
+    const BlitDestination *destinations = frag_map->destinations;
+
+    /* Destinations carry their own source pixels, so the fragments they were
+     * grouped in don't matter here */
+    for (int i = 0; i < frag_map->dest_count; i++) {
+        const BlitDestination *item = &destinations[i];
+        blit_sprite_copy(atlas, item->src, item->pixels, item->width, item->rows,
+                         dst_skip);
     }
 }
 
@@ -359,83 +829,106 @@ void
 blit_fragments_add(FragmentationMap *frag_map, pgSurfaceObject *dest,
                    DataBlock *block)
 {
-    PyObject **animation = PySequence_Fast_ITEMS(block->animation);
+    const SpriteAtlas *atlas = block_blit_atlas(block);
     const int dst_skip = dest->surf->pitch / 4;
 
 #if !defined(__EMSCRIPTEN__)
     if (_Has_AVX2()) {
-        blit_fragments_add_avx2(frag_map, animation, dst_skip);
+        blit_fragments_add_avx2(frag_map, atlas, dst_skip);
         return;
     }
 #if ENABLE_SSE_NEON
     if (_HasSSE_NEON()) {
-        blit_fragments_add_sse2(frag_map, animation, dst_skip);
+        blit_fragments_add_sse2(frag_map, atlas, dst_skip);
         return;
     }
 #endif /* ENABLE_SSE_NEON */
 #endif /* __EMSCRIPTEN__ */
 
-    blit_fragments_add_scalar(frag_map, animation, dst_skip);
+    blit_fragments_add_scalar(frag_map, atlas, dst_skip);
 }
 
+/* Adds one sprite of the atlas without SIMD, dst_pitch is in pixels */
 void
-blit_fragments_add_scalar(FragmentationMap *frag_map, PyObject **animation,
-                          int dst_skip)
+blit_sprite_add_scalar(const SpriteAtlas *atlas, const uint32_t *src, uint32_t *dst,
+                       int width, int rows, int dst_pitch)
 {
-    Fragment *fragments = frag_map->fragments;
-    BlitDestination *destinations = frag_map->destinations;
-    SDL_PixelFormat *fmt = ((pgSurfaceObject *)animation[0])->surf->format;
-
-#if SDL_BYTEORDER == SDL_LIL_ENDIAN
-    const int Ridx = fmt->Rshift >> 3;
-    const int Gidx = fmt->Gshift >> 3;
-    const int Bidx = fmt->Bshift >> 3;
-#else
-    const int Ridx = 3 - (fmt->Rshift >> 3);
-    const int Gidx = 3 - (fmt->Gshift >> 3);
-    const int Bidx = 3 - (fmt->Bshift >> 3);
-#endif
+    const int Ridx = atlas->Ridx;
+    const int Gidx = atlas->Gidx;
+    const int Bidx = atlas->Bidx;
 
-    for (int i = 0; i < frag_map->used_f; i++) {
-        Fragment *fragment = &fragments[i];
-        SDL_Surface *src_surf =
-            ((pgSurfaceObject *)animation[fragment->animation_index])->surf;
-        uint8_t *const src_start = (uint8_t *)src_surf->pixels;
+    const uint8_t *srcp8 = (const uint8_t *)src;
+    uint8_t *dstp8 = (uint8_t *)dst;
+    const int actual_dst_skip = 4 * (dst_pitch - width);
+    const int src_skip = 4 * (atlas->pitch - width);
 
-        for (int j = 0; j < fragment->length; j++) {
-            BlitDestination *item = &destinations[j];
+    int h = rows;
 
-            uint8_t *srcp8 = src_start + item->src_offset * 4;
-            uint8_t *dstp8 = (uint8_t *)item->pixels;
-            const int actual_dst_skip = 4 * (dst_skip - item->width);
-            const int src_skip = src_surf->pitch - item->width * 4;
+    while (h--) {
+        for (int k = 0; k < width; k++) {
+            uint8_t sr = srcp8[Ridx];
+            uint8_t sg = srcp8[Gidx];
+            uint8_t sb = srcp8[Bidx];
 
-            int h = item->rows;
+            uint8_t dr = dstp8[Ridx];
+            uint8_t dg = dstp8[Gidx];
+            uint8_t db = dstp8[Bidx];
 
-            while (h--) {
-                for (int k = 0; k < item->width; k++) {
-                    uint8_t sr = srcp8[Ridx];
-                    uint8_t sg = srcp8[Gidx];
-                    uint8_t sb = srcp8[Bidx];
+            dstp8[Ridx] = sr + dr > 255 ? 255 : sr + dr;
+            dstp8[Gidx] = sg + dg > 255 ? 255 : sg + dg;
+            dstp8[Bidx] = sb + db > 255 ? 255 : sb + db;
 
-                    uint8_t dr = dstp8[Ridx];
-                    uint8_t dg = dstp8[Gidx];
-                    uint8_t db = dstp8[Bidx];
+            srcp8 += 4;
+            dstp8 += 4;
+        }
 
-                    dstp8[Ridx] = sr + dr > 255 ? 255 : sr + dr;
-                    dstp8[Gidx] = sg + dg > 255 ? 255 : sg + dg;
-                    dstp8[Bidx] = sb + db > 255 ? 255 : sb + db;
+        srcp8 += src_skip;
+        dstp8 += actual_dst_skip;
+    }
+}
 
-                    srcp8 += 4;
-                    dstp8 += 4;
-                }
+void
+blit_fragments_add_scalar(FragmentationMap *frag_map, const SpriteAtlas *atlas,
+                          int dst_skip)
+{
+    const BlitDestination *destinations = frag_map->destinations;
 
-                srcp8 += src_skip;
-                dstp8 += actual_dst_skip;
-            }
-        }
+    for (int i = 0; i < frag_map->dest_count; i++) {
+        const BlitDestination *item = &destinations[i];
+        blit_sprite_add_scalar(atlas, item->src, item->pixels, item->width, item->rows,
+                               dst_skip);
+    }
+}
 
-        destinations += fragment->length;
+/* Adds one streak without SIMD, pitch is in pixels */
+void
+draw_streak_add_scalar(const SpriteAtlas *atlas, const Streak *streak,
+                       uint32_t *pixels, int pitch)
+{
+    const int Ridx = atlas->Ridx;
+    const int Gidx = atlas->Gidx;
+    const int Bidx = atlas->Bidx;
+
+    const uint8_t *color = (const uint8_t *)&streak->color;
+    const uint8_t sr = color[Ridx];
+    const uint8_t sg = color[Gidx];
+    const uint8_t sb = color[Bidx];
+
+    int32_t x = streak->x, y = streak->y;
+
+    for (int k = 0; k < streak->count; k++) {
+        uint8_t *dstp8 = (uint8_t *)(pixels + (y >> 16) * pitch + (x >> 16));
+
+        const uint8_t dr = dstp8[Ridx];
+        const uint8_t dg = dstp8[Gidx];
+        const uint8_t db = dstp8[Bidx];
+
+        dstp8[Ridx] = sr + dr > 255 ? 255 : sr + dr;
+        dstp8[Gidx] = sg + dg > 255 ? 255 : sg + dg;
+        dstp8[Bidx] = sb + db > 255 ? 255 : sb + db;
+
+        x += streak->step_x;
+        y += streak->step_y;
     }
 }
 
@@ -448,7 +941,7 @@ _compare_desc(const void *a, const void *b)
 }
 
 int
-find_first_leq_zero(const float *restrict arr, int size)
+find_first_leq(const float *restrict arr, int size, float value)
 {
     int low = 0;
     int high = size - 1;
@@ -456,7 +949,7 @@ find_first_leq_zero(const float *restrict arr, int size)
 
     while (low <= high) {
         int mid = (low + high) / 2;
-        if (arr[mid] > 0) {
+        if (arr[mid] > value) {
             low = mid + 1;
         }
         else {
@@ -471,8 +964,18 @@ find_first_leq_zero(const float *restrict arr, int size)
 void
 recalculate_particle_count(DataBlock *block)
 {
-    /* Find the first particle with a lifetime less than or equal to zero */
-    int index = find_first_leq_zero(block->lifetimes.data, block->particles_count);
+    /* With a shared max lifetime the whole block dies at once */
+    if (!block->max_lifetimes.data) {
+        if (block->age >= block->max_lifetime) {
+            block->particles_count = 0;
+            block->ended = true;
+        }
+        return;
+    }
+
+    /* Find the first particle whose death time the block's age has reached */
+    int index =
+        find_first_leq(block->max_lifetimes.data, block->particles_count, block->age);
 
     /* If all particles are alive the index will be -1, so just return */
     if (index == -1)
@@ -485,32 +988,222 @@ recalculate_particle_count(DataBlock *block)
 }
 
 int
-init_fragmentation_map(DataBlock *block)
+collide_bounds_scalar(DataBlock *block, const CollisionBounds *bounds)
+{
+    float *restrict positions_x = block->positions_x.data;
+    float *restrict positions_y = block->positions_y.data;
+    float *restrict velocities_x = block->velocities_x.data;
+    float *restrict velocities_y = block->velocities_y.data;
+
+    if (bounds->response == _COLLISION_KILL) {
+        for (int i = 0; i < block->particles_count; i++) {
+            if (outside_bounds(bounds, positions_x[i], positions_y[i]))
+                return i;
+        }
+
+        return -1;
+    }
+
+    const float neg_restitution = -bounds->restitution;
+    const float keep = 1.0f - bounds->friction;
+
+    for (int i = 0; i < block->particles_count; i++) {
+        float px = positions_x[i];
+        float py = positions_y[i];
+        float vx = velocities_x[i];
+        float vy = velocities_y[i];
+
+        bool lo = px < bounds->left;
+        bool hi = px > bounds->right;
+        px = lo ? bounds->left : px;
+        px = hi ? bounds->right : px;
+        vx = lo || hi ? vx * neg_restitution : vx;
+        vy = lo || hi ? vy * keep : vy;
+
+        lo = py < bounds->top;
+        hi = py > bounds->bottom;
+        py = lo ? bounds->top : py;
+        py = hi ? bounds->bottom : py;
+        vy = lo || hi ? vy * neg_restitution : vy;
+        vx = lo || hi ? vx * keep : vx;
+
+        positions_x[i] = px;
+        positions_y[i] = py;
+        velocities_x[i] = vx;
+        velocities_y[i] = vy;
+    }
+
+    return -1;
+}
+
+int
+collide_bounds(DataBlock *block, const CollisionBounds *bounds)
+{
+#if !defined(__EMSCRIPTEN__)
+    if (_Has_AVX2())
+        return collide_bounds_avx2(block, bounds);
+
+#if ENABLE_SSE_NEON
+    if (_HasSSE_NEON())
+        return collide_bounds_sse2(block, bounds);
+#endif /* ENABLE_SSE_NEON */
+#endif /* __EMSCRIPTEN__ */
+
+    return collide_bounds_scalar(block, bounds);
+}
+
+int
+collide_grid_scalar(DataBlock *block, const OccupancyGrid *grid, float dt)
+{
+    float *restrict positions_x = block->positions_x.data;
+    float *restrict positions_y = block->positions_y.data;
+    float *restrict velocities_x = block->velocities_x.data;
+    float *restrict velocities_y = block->velocities_y.data;
+
+    if (grid->response == _COLLISION_KILL) {
+        for (int i = 0; i < block->particles_count; i++) {
+            if (grid_cell_solid(grid, positions_x[i], positions_y[i]))
+                return i;
+        }
+
+        return -1;
+    }
+
+    const float neg_restitution = -grid->restitution;
+
+    for (int i = 0; i < block->particles_count; i++) {
+        const float px = positions_x[i];
+        const float py = positions_y[i];
+        const float vx = velocities_x[i];
+        const float vy = velocities_y[i];
+        const float ox = px - vx * dt;
+        const float oy = py - vy * dt;
+
+        /* Probe each axis on its own to find which side was hit, if neither
+         * explains the hit it was a corner and both axes bounce */
+        const bool hit = grid_cell_solid(grid, px, py);
+        const bool hit_x = grid_cell_solid(grid, px, oy);
+        const bool hit_y = grid_cell_solid(grid, ox, py);
+        const bool corner = !hit_x && !hit_y;
+        const bool flip_x = hit && (hit_x || corner);
+        const bool flip_y = hit && (hit_y || corner);
+
+        positions_x[i] = flip_x ? ox : px;
+        positions_y[i] = flip_y ? oy : py;
+        velocities_x[i] = flip_x ? vx * neg_restitution : vx;
+        velocities_y[i] = flip_y ? vy * neg_restitution : vy;
+    }
+
+    return -1;
+}
+
+int
+collide_grid(DataBlock *block, const OccupancyGrid *grid, float dt)
+{
+#if !defined(__EMSCRIPTEN__)
+    if (_Has_AVX2())
+        return collide_grid_avx2(block, grid, dt);
+
+#if ENABLE_SSE_NEON
+    if (_HasSSE_NEON())
+        return collide_grid_sse2(block, grid, dt);
+#endif /* ENABLE_SSE_NEON */
+#endif /* __EMSCRIPTEN__ */
+
+    return collide_grid_scalar(block, grid, dt);
+}
+
+void
+remove_killed_particles(DataBlock *block, int first, const CollisionBounds *bounds,
+                        const OccupancyGrid *grid)
+{
+    /* Stable compaction, the relative order of the survivors (and so the
+     * descending max_lifetimes order) is preserved. The kill test is the one
+     * the collision pass used, with only one of bounds and grid given */
+    float *positions_x = block->positions_x.data;
+    float *positions_y = block->positions_y.data;
+    float *velocities_x = block->velocities_x.data;
+    float *velocities_y = block->velocities_y.data;
+    float *accelerations_x = block->accelerations_x.data;
+    float *accelerations_y = block->accelerations_y.data;
+    uint16_t *accelerations_x_h = block->accelerations_x_h.data;
+    uint16_t *accelerations_y_h = block->accelerations_y_h.data;
+    float *max_lifetimes = block->max_lifetimes.data;
+    float *angles = block->angles.data;
+    float *angular_velocities = block->angular_velocities.data;
+    float *scales = block->scales.data;
+
+    int alive = first;
+
+    for (int i = first; i < block->particles_count; i++) {
+        const bool hit = bounds ? outside_bounds(bounds, positions_x[i], positions_y[i])
+                                : grid_cell_solid(grid, positions_x[i], positions_y[i]);
+        if (hit)
+            continue;
+
+        if (alive != i) {
+            positions_x[alive] = positions_x[i];
+            positions_y[alive] = positions_y[i];
+            if (velocities_x)
+                velocities_x[alive] = velocities_x[i];
+            if (velocities_y)
+                velocities_y[alive] = velocities_y[i];
+            if (accelerations_x)
+                accelerations_x[alive] = accelerations_x[i];
+            if (accelerations_y)
+                accelerations_y[alive] = accelerations_y[i];
+            if (accelerations_x_h)
+                accelerations_x_h[alive] = accelerations_x_h[i];
+            if (accelerations_y_h)
+                accelerations_y_h[alive] = accelerations_y_h[i];
+            if (max_lifetimes)
+                max_lifetimes[alive] = max_lifetimes[i];
+            if (angles)
+                angles[alive] = angles[i];
+            if (angular_velocities)
+                angular_velocities[alive] = angular_velocities[i];
+            if (scales)
+                scales[alive] = scales[i];
+        }
+
+        alive++;
+    }
+
+    block->particles_count = alive;
+
+    if (!alive)
+        block->ended = true;
+}
+
+/* The maps are rebuilt from scratch on every draw, so instead of each block
+ * keeping its own arrays around they are carved out of the draw's arena.
+ * Destinations are only needed when the sprites aren't blitted in place */
+int
+prepare_fragmentation_map(DataBlock *block, ScratchArena *scratch, bool materialize)
 {
     FragmentationMap *frag_map = &block->frag_map;
 
-    frag_map->fragments = PyMem_New(Fragment, block->num_frames);
-    if (!frag_map->fragments)
-        return 0;
+    const size_t fragments_size = sizeof(Fragment) * block->num_frames;
+    const size_t starts_size = sizeof(int) * (block->num_frames + 1);
+    const size_t destinations_size =
+        materialize ? sizeof(BlitDestination) * block->particles_count : 0;
 
-    frag_map->destinations = PyMem_New(BlitDestination, block->particles_count);
-    if (!frag_map->destinations)
+    if (!scratch_arena_reset(scratch, SCRATCH_ROUND(fragments_size) +
+                                          SCRATCH_ROUND(starts_size) +
+                                          SCRATCH_ROUND(destinations_size)))
         return 0;
 
+    frag_map->fragments = scratch_arena_alloc(scratch, fragments_size);
+    frag_map->frame_starts = scratch_arena_alloc(scratch, starts_size);
+    frag_map->destinations = scratch_arena_alloc(scratch, destinations_size);
     frag_map->used_f = 0;
-    frag_map->alloc_f = block->num_frames;
     frag_map->dest_count = 0;
+    frag_map->streamed = 0;
+    frag_map->streamed_pixels = 0;
 
     return 1;
 }
 
-void
-dealloc_fragmentation_map(FragmentationMap *frag_map)
-{
-    PyMem_Free(frag_map->fragments);
-    PyMem_Free(frag_map->destinations);
-}
-
 int
 alloc_and_init_positions(DataBlock *block, Emitter *emitter, vec2 position)
 {
@@ -541,11 +1234,14 @@ alloc_and_init_positions(DataBlock *block, Emitter *emitter, vec2 position)
 }
 
 int
-alloc_and_init_velocities(DataBlock *block, Emitter *emitter)
+alloc_and_init_velocities(DataBlock *block, Emitter *emitter, MTState *rng)
 {
-    /* Check if the emitter has no speed */
-    if (emitter->speed_x.min == 0.0f && emitter->speed_x.max == 0.0f &&
-        emitter->speed_y.min == 0.0f && emitter->speed_y.max == 0.0f)
+    /* Particles spawned at rest with nothing to accelerate them don't move on
+     * their own, they get velocities from alloc_resting_velocities() once an
+     * attractor or a bounce can push them. Noise only moves positions */
+    if (!emitter->speed_x.randomize && emitter->speed_x.min == 0.0f &&
+        !emitter->speed_y.randomize && emitter->speed_y.min == 0.0f &&
+        !emitter->acceleration_x.in_use && !emitter->acceleration_y.in_use)
         return 1;
 
     float_array *x = &block->velocities_x;
@@ -558,15 +1254,37 @@ alloc_and_init_velocities(DataBlock *block, Emitter *emitter)
 
     /* Initialize the velocities array */
     for (int i = 0; i < emitter->emission_number; i++) {
-        x->data[i] = genrand_from(&emitter->speed_x);
-        y->data[i] = genrand_from(&emitter->speed_y);
+        x->data[i] = genrand_from(rng, &emitter->speed_x);
+        y->data[i] = genrand_from(rng, &emitter->speed_y);
     }
 
     return 1;
 }
 
 int
-alloc_and_init_accelerations(DataBlock *block, Emitter *emitter)
+alloc_resting_velocities(DataBlock *block)
+{
+    float_array *x = &block->velocities_x;
+    float_array *y = &block->velocities_y;
+
+    if (x->data)
+        return 1;
+
+    /* Both or neither, the update only checks velocities_x */
+    if (!float_array_calloc(x, block->particles_count))
+        return 0;
+
+    if (!float_array_calloc(y, block->particles_count)) {
+        float_array_free(x);
+        x->data = NULL;
+        return 0;
+    }
+
+    return 1;
+}
+
+int
+alloc_and_init_accelerations(DataBlock *block, Emitter *emitter, MTState *rng)
 {
     /* Check if the emitter has no acceleration */
     const int alloc_x = emitter->acceleration_x.in_use;
@@ -575,6 +1293,28 @@ alloc_and_init_accelerations(DataBlock *block, Emitter *emitter)
     if (!alloc_x && !alloc_y)
         return 1;
 
+    if (emitter->compact) {
+        half_array *hx = &block->accelerations_x_h;
+        half_array *hy = &block->accelerations_y_h;
+
+        if (alloc_x && !half_array_alloc(hx, emitter->emission_number))
+            return 0;
+
+        if (alloc_y && !half_array_alloc(hy, emitter->emission_number))
+            return 0;
+
+        /* Drawn in the same order as below, so a compact emitter consumes the
+         * same random numbers as a regular one */
+        for (int i = 0; i < emitter->emission_number; i++) {
+            if (alloc_x)
+                hx->data[i] = float_to_half(genrand_from(rng, &emitter->acceleration_x));
+            if (alloc_y)
+                hy->data[i] = float_to_half(genrand_from(rng, &emitter->acceleration_y));
+        }
+
+        return 1;
+    }
+
     float_array *x = &block->accelerations_x;
     float_array *y = &block->accelerations_y;
 
@@ -588,168 +1328,269 @@ alloc_and_init_accelerations(DataBlock *block, Emitter *emitter)
     /* Initialize the accelerations arrays */
     for (int i = 0; i < emitter->emission_number; i++) {
         if (alloc_x)
-            x->data[i] = genrand_from(&emitter->acceleration_x);
+            x->data[i] = genrand_from(rng, &emitter->acceleration_x);
         if (alloc_y)
-            y->data[i] = genrand_from(&emitter->acceleration_y);
+            y->data[i] = genrand_from(rng, &emitter->acceleration_y);
     }
 
     return 1;
 }
 
 int
-alloc_and_init_lifetimes(DataBlock *block, Emitter *emitter)
+alloc_and_init_lifetimes(DataBlock *block, Emitter *emitter, MTState *rng)
 {
-    /* Lifetimes must be allocated since no particle can last forever */
-    float_array *lifetimes = &block->lifetimes;
     float_array *max_lifetimes = &block->max_lifetimes;
     const int num_particles = emitter->emission_number;
 
-    if (!float_array_alloc(lifetimes, num_particles) ||
-        !float_array_alloc(max_lifetimes, num_particles))
+    /* Without randomization every particle shares the same lifetime, the
+     * block keeps it once and needs neither the sort nor max_lifetimes */
+    if (!emitter->lifetime.randomize) {
+        block->max_lifetime = genrand_from(rng, &emitter->lifetime);
+        return 1;
+    }
+
+    if (!float_array_alloc(max_lifetimes, num_particles))
         return 0;
 
     for (int i = 0; i < num_particles; i++)
-        lifetimes->data[i] = genrand_from(&emitter->lifetime);
+        max_lifetimes->data[i] = genrand_from(rng, &emitter->lifetime);
 
-    /* Sort lifetimes in descending order */
-    qsort(lifetimes->data, num_particles, sizeof(float), _compare_desc);
+    /* Sort in descending order, the particles then die from the back */
+    qsort(max_lifetimes->data, num_particles, sizeof(float), _compare_desc);
 
-    /* Copy the sorted lifetimes to the max_lifetimes array */
-    memcpy(max_lifetimes->data, lifetimes->data, sizeof(float) * num_particles);
+    return 1;
+}
+
+static int
+alloc_and_init_channel(float_array *channel, float *shared, const generator *gen,
+                       int num_particles, MTState *rng)
+{
+    if (!gen->randomize) {
+        *shared = gen->min;
+        return 1;
+    }
+
+    if (!float_array_alloc(channel, num_particles))
+        return 0;
+
+    for (int i = 0; i < num_particles; i++)
+        channel->data[i] = genrand_from(rng, gen);
 
     return 1;
 }
 
 int
-alloc_and_init_animation_indices(DataBlock *block, Emitter *emitter)
+alloc_and_init_transforms(DataBlock *block, Emitter *emitter, MTState *rng)
 {
-    block->animation_indices = PyMem_New(int, emitter->emission_number);
+    /* Drawn last, so emitters that don't rotate or scale consume the same
+     * random numbers as before these existed */
+    if (!emitter->variants)
+        return 1;
 
-    return block->animation_indices != NULL;
+    const int num_particles = emitter->emission_number;
+
+    return alloc_and_init_channel(&block->angles, &block->angle, &emitter->angle,
+                                  num_particles, rng) &&
+           alloc_and_init_channel(&block->angular_velocities,
+                                  &block->angular_velocity,
+                                  &emitter->angular_velocity, num_particles, rng) &&
+           alloc_and_init_channel(&block->scales, &block->scale, &emitter->scale,
+                                  num_particles, rng);
 }
 
-void
-update_with_acceleration(DataBlock *block, float dt)
+/* Shared body of the scalar updaters, see DEFINE_UPDATER_TABLE */
+static FORCEINLINE void
+update_particles_scalar(DataBlock *block, float dt, const int features)
 {
     float *restrict positions_x = block->positions_x.data;
     float *restrict positions_y = block->positions_y.data;
     float *restrict velocities_x = block->velocities_x.data;
     float *restrict velocities_y = block->velocities_y.data;
-    float *restrict lifetimes = block->lifetimes.data;
     float const *restrict accelerations_x = block->accelerations_x.data;
     float const *restrict accelerations_y = block->accelerations_y.data;
-    float const *restrict max_lifetimes = block->max_lifetimes.data;
-    int *restrict indices = block->animation_indices;
+    uint16_t const *restrict accelerations_x_h = block->accelerations_x_h.data;
+    uint16_t const *restrict accelerations_y_h = block->accelerations_y_h.data;
 
     for (int i = 0; i < block->particles_count; i++) {
-        velocities_x[i] += accelerations_x[i] * dt;
-        velocities_y[i] += accelerations_y[i] * dt;
+        if (features & _UPDATE_ACC_X) {
+            const float ax = features & _UPDATE_COMPACT
+                                 ? half_to_float(accelerations_x_h[i])
+                                 : accelerations_x[i];
+            velocities_x[i] += ax * dt;
+        }
+        if (features & _UPDATE_ACC_Y) {
+            const float ay = features & _UPDATE_COMPACT
+                                 ? half_to_float(accelerations_y_h[i])
+                                 : accelerations_y[i];
+            velocities_y[i] += ay * dt;
+        }
         positions_x[i] += velocities_x[i] * dt;
         positions_y[i] += velocities_y[i] * dt;
-
-        lifetimes[i] -= dt;
-        indices[i] =
-            (int)((1.0f - lifetimes[i] / max_lifetimes[i]) * block->num_frames);
     }
 }
 
+DEFINE_UPDATER_TABLE(updaters_scalar, update_particles_scalar)
+
 void
-update_with_no_acceleration(DataBlock *block, float dt)
+apply_attractors_scalar(DataBlock *block, const Attractor *attractors, int count,
+                        float dt)
 {
-    float *restrict positions_x = block->positions_x.data;
-    float *restrict positions_y = block->positions_y.data;
-    float *restrict lifetimes = block->lifetimes.data;
-    float const *restrict velocities_x = block->velocities_x.data;
-    float const *restrict velocities_y = block->velocities_y.data;
-    float const *restrict max_lifetimes = block->max_lifetimes.data;
-    int *restrict indices = block->animation_indices;
+    float const *restrict positions_x = block->positions_x.data;
+    float const *restrict positions_y = block->positions_y.data;
+    float *restrict velocities_x = block->velocities_x.data;
+    float *restrict velocities_y = block->velocities_y.data;
 
     for (int i = 0; i < block->particles_count; i++) {
-        positions_x[i] += velocities_x[i] * dt;
-        positions_y[i] += velocities_y[i] * dt;
+        float ax = 0.0f, ay = 0.0f;
+
+        for (int j = 0; j < count; j++) {
+            const Attractor *a = &attractors[j];
+            const float dx = a->position.x - positions_x[i];
+            const float dy = a->position.y - positions_y[i];
+            float d2 = dx * dx + dy * dy;
+
+            /* Clamp to one pixel so particles sitting on the attractor don't
+             * blow up, same as the SIMD max_ps */
+            d2 = d2 > 1.0f ? d2 : 1.0f;
+            const float d = sqrtf(d2);
+
+            const float mag = a->falloff == _FALLOFF_LINEAR
+                                  ? a->strength * (1.0f - d / a->radius) / d
+                                  : a->strength / (d2 * d);
+
+            const bool inside = d2 < a->radius * a->radius;
+            ax += inside ? dx * mag : 0.0f;
+            ay += inside ? dy * mag : 0.0f;
+        }
 
-        lifetimes[i] -= dt;
-        indices[i] =
-            (int)((1.0f - lifetimes[i] / max_lifetimes[i]) * block->num_frames);
+        velocities_x[i] += ax * dt;
+        velocities_y[i] += ay * dt;
     }
 }
 
 void
-update_with_acceleration_x(DataBlock *block, float dt)
+apply_attractors(DataBlock *block, const Attractor *attractors, int count, float dt)
 {
-    float *restrict positions_x = block->positions_x.data;
-    float *restrict positions_y = block->positions_y.data;
-    float *restrict velocities_x = block->velocities_x.data;
-    float const *restrict velocities_y = block->velocities_y.data;
-    float const *restrict accelerations_x = block->accelerations_x.data;
-    float const *restrict max_lifetimes = block->max_lifetimes.data;
-    float *restrict lifetimes = block->lifetimes.data;
-    int *restrict indices = block->animation_indices;
-
-    for (int i = 0; i < block->particles_count; i++) {
-        velocities_x[i] += accelerations_x[i] * dt;
-        positions_x[i] += velocities_x[i] * dt;
-        positions_y[i] += velocities_y[i] * dt;
+#if !defined(__EMSCRIPTEN__)
+    if (_Has_AVX2()) {
+        apply_attractors_avx2(block, attractors, count, dt);
+        return;
+    }
 
-        lifetimes[i] -= dt;
-        indices[i] =
-            (int)((1.0f - lifetimes[i] / max_lifetimes[i]) * block->num_frames);
+#if ENABLE_SSE_NEON
+    if (_HasSSE_NEON()) {
+        apply_attractors_sse2(block, attractors, count, dt);
+        return;
     }
+#endif /* ENABLE_SSE_NEON */
+#endif /* __EMSCRIPTEN__ */
+
+    apply_attractors_scalar(block, attractors, count, dt);
 }
 
 void
-update_with_acceleration_y(DataBlock *block, float dt)
+apply_noise_scalar(DataBlock *block, float dt)
 {
     float *restrict positions_x = block->positions_x.data;
     float *restrict positions_y = block->positions_y.data;
-    float *restrict velocities_y = block->velocities_y.data;
-    float *restrict lifetimes = block->lifetimes.data;
-    float const *restrict max_lifetimes = block->max_lifetimes.data;
-    float const *restrict velocities_x = block->velocities_x.data;
-    float const *restrict accelerations_y = block->accelerations_y.data;
-    int *restrict indices = block->animation_indices;
 
-    for (int i = 0; i < block->particles_count; i++) {
-        velocities_y[i] += accelerations_y[i] * dt;
-        positions_x[i] += velocities_x[i] * dt;
-        positions_y[i] += velocities_y[i] * dt;
+    const float freq = block->noise.frequency;
+    const float offset = block->noise_offset;
+    const float scale = block->noise.strength * dt;
 
-        lifetimes[i] -= dt;
-        indices[i] =
-            (int)((1.0f - lifetimes[i] / max_lifetimes[i]) * block->num_frames);
+    for (int i = 0; i < block->particles_count; i++) {
+        const float u = positions_x[i] * freq;
+        const float v = positions_y[i] * freq + offset;
+        const float fu = floorf(u);
+        const float fv = floorf(v);
+        const float tx = u - fu;
+        const float ty = v - fv;
+
+        const int x0 = (int)fu & NOISE_LATTICE_MASK;
+        const int y0 = (int)fv & NOISE_LATTICE_MASK;
+        const int x1 = (x0 + 1) & NOISE_LATTICE_MASK;
+        const int y1 = (y0 + 1) & NOISE_LATTICE_MASK;
+
+        const int i00 = (y0 << NOISE_LATTICE_BITS) | x0;
+        const int i10 = (y0 << NOISE_LATTICE_BITS) | x1;
+        const int i01 = (y1 << NOISE_LATTICE_BITS) | x0;
+        const int i11 = (y1 << NOISE_LATTICE_BITS) | x1;
+
+        float top = curl_noise_x[i00] + (curl_noise_x[i10] - curl_noise_x[i00]) * tx;
+        float bot = curl_noise_x[i01] + (curl_noise_x[i11] - curl_noise_x[i01]) * tx;
+        const float nx = top + (bot - top) * ty;
+
+        top = curl_noise_y[i00] + (curl_noise_y[i10] - curl_noise_y[i00]) * tx;
+        bot = curl_noise_y[i01] + (curl_noise_y[i11] - curl_noise_y[i01]) * tx;
+        const float ny = top + (bot - top) * ty;
+
+        positions_x[i] += nx * scale;
+        positions_y[i] += ny * scale;
     }
 }
 
 void
-update_indices_scalar(DataBlock *block)
-{
-    float const *restrict lifetimes = block->lifetimes.data;
-    float const *restrict max_lifetimes = block->max_lifetimes.data;
-    int *restrict indices = block->animation_indices;
-
-    for (int i = 0; i < block->particles_count; i++)
-        indices[i] =
-            (int)((1.0f - lifetimes[i] / max_lifetimes[i]) * block->num_frames);
-}
-
-void
-update_indices(DataBlock *block)
+apply_noise(DataBlock *block, float dt)
 {
 #if !defined(__EMSCRIPTEN__)
     if (_Has_AVX2()) {
-        update_indices_avx2(block);
+        apply_noise_avx2(block, dt);
         return;
     }
 
 #if ENABLE_SSE_NEON
     if (_HasSSE_NEON()) {
-        update_indices_sse2(block);
+        apply_noise_sse2(block, dt);
         return;
     }
 #endif /* ENABLE_SSE_NEON */
 #endif /* __EMSCRIPTEN__ */
 
-    update_indices_scalar(block);
+    apply_noise_scalar(block, dt);
+}
+
+void
+find_frame_boundaries_scalar(const DataBlock *block, int *starts)
+{
+    float const *restrict max_lifetimes = block->max_lifetimes.data;
+    const float age = block->age;
+
+    /* A particle is on frame >= k once age >= max_lifetime * k / num_frames,
+     * which is monotonic over the descending max_lifetimes, so the first such
+     * particle can be binary searched */
+    for (int k = 1; k < block->num_frames; k++) {
+        const float fraction = frame_fraction(k, block->num_frames);
+        int lo = 0, hi = block->particles_count;
+
+        while (lo < hi) {
+            const int mid = (int)((unsigned int)(lo + hi) >> 1);
+            if (age >= max_lifetimes[mid] * fraction)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+
+        starts[k] = lo;
+    }
+}
+
+void
+find_frame_boundaries(const DataBlock *block, int *starts)
+{
+    /* With a shared max lifetime all the particles are on the same frame */
+    if (!block->max_lifetimes.data) {
+        for (int k = 1; k < block->num_frames; k++)
+            starts[k] = block->age >= block->max_lifetime *
+                                          frame_fraction(k, block->num_frames)
+                            ? 0
+                            : block->particles_count;
+
+        return;
+    }
+
+    /* A vector version runs one serial gather per search step, which loses
+     * to these branchy searches at any frame count */
+    find_frame_boundaries_scalar(block, starts);
 }
 
 int FORCEINLINE
@@ -1,9 +1,19 @@
 #include "include/effect_instance.h"
 
 int
-init_effect_instance(EffectInstance *instance, ParticleEffect *effect, vec2 position)
+init_effect_instance(EffectInstance *instance, ParticleEffect *effect, vec2 position,
+                     float spawn_scale, MTState *rng)
 {
     instance->position = position;
+
+    /* Nothing fits in the budget, the effect is born ended */
+    if (spawn_scale <= 0.0f) {
+        instance->p_data = NULL;
+        instance->blocks_count = 0;
+        instance->ended = true;
+        return 1;
+    }
+
     instance->blocks_count = effect->emitters_count;
     instance->ended = false;
 
@@ -18,17 +28,31 @@ init_effect_instance(EffectInstance *instance, ParticleEffect *effect, vec2 posi
 
     /* Initialize each data block, one per emitter */
     for (Py_ssize_t i = 0; i < effect->emitters_count; i++) {
-        Emitter *emitter = &((EmitterObject *)emitter_objs[i])->emitter;
+        /* A scaled down burst keeps at least one particle per emitter */
+        Emitter emitter = ((EmitterObject *)emitter_objs[i])->emitter;
+        if (spawn_scale < 1.0f)
+            emitter.emission_number =
+                MAX(1, (int)(emitter.emission_number * spawn_scale));
+
         DataBlock *db = &instance->p_data[i];
-        if (!init_data_block(db, emitter, position))
+        if (!init_data_block(db, &emitter, position, rng))
             return 0;
+
+        db->bounds = effect->bounds;
+
+        /* A bounce writes the velocities even of particles at rest */
+        if (db->bounds.in_use && db->bounds.response == _COLLISION_BOUNCE &&
+            !alloc_resting_velocities(db)) {
+            PyErr_NoMemory();
+            return 0;
+        }
     }
 
     return 1;
 }
 
 void
-update_effect_instance(EffectInstance *instance, float dt)
+update_effect_instance(EffectInstance *instance, float dt, const UpdateContext *ctx)
 {
     int active_blocks = 0;
 
@@ -36,7 +60,7 @@ update_effect_instance(EffectInstance *instance, float dt)
         if (instance->p_data[i].ended)
             continue;
 
-        update_data_block(&instance->p_data[i], dt);
+        update_data_block(&instance->p_data[i], dt, ctx);
 
         if (!instance->p_data[i].ended)
             active_blocks++;
@@ -47,14 +71,63 @@ update_effect_instance(EffectInstance *instance, float dt)
 }
 
 int
-draw_effect_instance(EffectInstance *instance, pgSurfaceObject *dest)
+draw_effect_instance(EffectInstance *instance, pgSurfaceObject *dest,
+                     const DrawContext *ctx)
+{
+    for (Py_ssize_t i = 0; i < instance->blocks_count; i++) {
+        DataBlock *block = &instance->p_data[i];
+
+        trace_begin(ctx->tracer, "draw_data_block", (int)i);
+        int ok = draw_data_block(block, dest, block->blend_mode, ctx);
+        trace_end(ctx->tracer, "draw_data_block");
+
+        if (!ok)
+            return 0;
+    }
+
+    return 1;
+}
+
+int
+update_and_draw_effect_instance(EffectInstance *instance, float dt, int steps,
+                                const UpdateContext *update_ctx,
+                                pgSurfaceObject *dest, const DrawContext *draw_ctx,
+                                uint64_t *draw_ticks)
 {
+    int active_blocks = 0;
+
+    /* Blocks don't depend on each other, so running all the steps of one
+     * block before the next matches update() and draws it while hot */
     for (Py_ssize_t i = 0; i < instance->blocks_count; i++) {
         DataBlock *block = &instance->p_data[i];
-        if (!draw_data_block(block, dest, block->blend_mode))
+        if (block->ended)
+            continue;
+
+        trace_begin(update_ctx->tracer, "update_data_block", (int)i);
+        for (int step = 0; step < steps && !block->ended; step++)
+            update_data_block(block, dt, update_ctx);
+        trace_end(update_ctx->tracer, "update_data_block");
+
+        if (block->ended)
+            continue;
+
+        active_blocks++;
+
+        const uint64_t start = SDL_GetPerformanceCounter();
+
+        trace_begin(draw_ctx->tracer, "draw_data_block", (int)i);
+        int ok = draw_data_block(block, dest, block->blend_mode, draw_ctx);
+        trace_end(draw_ctx->tracer, "draw_data_block");
+
+        *draw_ticks += SDL_GetPerformanceCounter() - start;
+
+        if (!ok)
             return 0;
     }
 
+    if (active_blocks == 0)
+        instance->ended = true;
+
     return 1;
 }
 
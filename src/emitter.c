@@ -10,10 +10,17 @@ emitter_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 
     memset(&self->emitter, 0, sizeof(Emitter));
     self->emitter.blend_mode = 1;
+    self->emitter.noise.frequency = 0.05f;
 
     return (PyObject *)self;
 }
 
+static FORCEINLINE bool
+gen_is_finite(const generator *gen)
+{
+    return isfinite(gen->min) && (!gen->randomize || isfinite(gen->max));
+}
+
 static FORCEINLINE int
 initGen_FromObj(PyObject *obj, generator *gen)
 {
@@ -109,22 +116,48 @@ emitter_init(EmitterObject *self, PyObject *args, PyObject *kwds)
 {
     Emitter *emitter = &self->emitter;
 
-    static char *kwlist[] = {
-        "emit_shape", "emit_number", "animation",      "particle_lifetime",
-        "speed_x",    "speed_y",     "acceleration_x", "acceleration_y",
-        "blend_mode", NULL};
+    static char *kwlist[] = {"emit_shape",
+                             "emit_number",
+                             "animation",
+                             "particle_lifetime",
+                             "speed_x",
+                             "speed_y",
+                             "acceleration_x",
+                             "acceleration_y",
+                             "blend_mode",
+                             "noise_strength",
+                             "noise_frequency",
+                             "noise_scroll",
+                             "compact",
+                             "analytic",
+                             "angle",
+                             "angular_velocity",
+                             "scale",
+                             "rotation_steps",
+                             "scale_steps",
+                             "streak",
+                             NULL};
 
     PyObject *animation = NULL;
     PyObject *lifetime_obj = NULL, *speedx_obj = NULL, *speedy_obj = NULL,
-             *accx_obj = NULL, *accy_obj = NULL;
+             *accx_obj = NULL, *accy_obj = NULL, *angle_obj = NULL,
+             *spin_obj = NULL, *scale_obj = NULL;
+    int compact = 0, analytic = 0;
+    int rotation_steps = 32, scale_steps = 8;
 
     if (!PyArg_ParseTupleAndKeywords(
-            args, kwds, "iiOO|OOOOi", kwlist, &emitter->spawn_shape,
+            args, kwds, "iiOO|OOOOifffppOOOiif", kwlist, &emitter->spawn_shape,
             &emitter->emission_number, &animation, &lifetime_obj, &speedx_obj,
-            &speedy_obj, &accx_obj, &accy_obj, &emitter->blend_mode)) {
+            &speedy_obj, &accx_obj, &accy_obj, &emitter->blend_mode,
+            &emitter->noise.strength, &emitter->noise.frequency,
+            &emitter->noise.scroll, &compact, &analytic, &angle_obj, &spin_obj,
+            &scale_obj, &rotation_steps, &scale_steps, &emitter->streak)) {
         return -1;
     }
 
+    emitter->compact = compact;
+    emitter->analytic = analytic;
+
     switch (emitter->spawn_shape) {
         case _POINT:
             break;
@@ -186,6 +219,11 @@ emitter_init(EmitterObject *self, PyObject *args, PyObject *kwds)
                 return -1;
             }
         }
+
+        sprite_atlas_decref(emitter->atlas);
+        emitter->atlas = sprite_atlas_from_frames(items, len);
+        if (!emitter->atlas)
+            return -1;
     }
     else {
         PyErr_SetString(
@@ -198,7 +236,7 @@ emitter_init(EmitterObject *self, PyObject *args, PyObject *kwds)
         PyErr_SetString(PyExc_TypeError, "Invalid lifetime argument");
         return -1;
     }
-    else {
+    else if (!lifetime_obj) {
         emitter->lifetime.min = 60.0f;
     }
 
@@ -222,6 +260,69 @@ emitter_init(EmitterObject *self, PyObject *args, PyObject *kwds)
         return -1;
     }
 
+    if (angle_obj && !initGen_FromObj(angle_obj, &emitter->angle)) {
+        PyErr_SetString(PyExc_TypeError, "Invalid angle argument");
+        return -1;
+    }
+
+    if (spin_obj && !initGen_FromObj(spin_obj, &emitter->angular_velocity)) {
+        PyErr_SetString(PyExc_TypeError, "Invalid angular_velocity argument");
+        return -1;
+    }
+
+    if (scale_obj && !initGen_FromObj(scale_obj, &emitter->scale)) {
+        PyErr_SetString(PyExc_TypeError, "Invalid scale argument");
+        return -1;
+    }
+    else if (!scale_obj) {
+        emitter->scale.min = 1.0f;
+    }
+
+    /* They pick the sprite variant, a NaN or infinity has no bucket */
+    if (!gen_is_finite(&emitter->angle) || !gen_is_finite(&emitter->angular_velocity) ||
+        !gen_is_finite(&emitter->scale)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "Invalid angle, angular_velocity or scale, must be finite");
+        return -1;
+    }
+
+    if (emitter->scale.min <= 0.0f) {
+        PyErr_SetString(PyExc_ValueError, "Invalid scale, must be positive");
+        return -1;
+    }
+
+    if (rotation_steps < 1 || rotation_steps > 360) {
+        PyErr_SetString(PyExc_ValueError,
+                        "Invalid rotation_steps, must be between 1 and 360");
+        return -1;
+    }
+
+    if (scale_steps < 1 || scale_steps > 64) {
+        PyErr_SetString(PyExc_ValueError,
+                        "Invalid scale_steps, must be between 1 and 64");
+        return -1;
+    }
+
+    if (emitter->streak < 0.0f) {
+        PyErr_SetString(PyExc_ValueError, "Invalid streak, must not be negative");
+        return -1;
+    }
+
+    sprite_variants_decref(emitter->variants);
+    emitter->variants = NULL;
+
+    /* Only the channels that can vary get more than one bucket, streaks draw
+     * no sprites so they need none */
+    const bool rotates = emitter->angle.in_use || emitter->angular_velocity.in_use;
+    if ((rotates || emitter->scale.in_use) && emitter->streak == 0.0f) {
+        emitter->variants = sprite_variants_new(
+            emitter->atlas, rotates ? rotation_steps : 1,
+            emitter->scale.randomize ? scale_steps : 1, emitter->scale.min,
+            emitter->scale.max);
+        if (!emitter->variants)
+            return -1;
+    }
+
     return 0;
 }
 
@@ -326,6 +427,8 @@ void
 emitter_dealloc(EmitterObject *self)
 {
     Py_XDECREF(self->emitter.animation);
+    sprite_variants_decref(self->emitter.variants);
+    sprite_atlas_decref(self->emitter.atlas);
 
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
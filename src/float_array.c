@@ -28,3 +28,20 @@ float_array_free(float_array *v)
     PyMem_Free(v->data);
     v->capacity = 0;
 }
+
+int
+half_array_alloc(half_array *v, Py_ssize_t capacity)
+{
+    v->capacity = capacity;
+    v->data = PyMem_New(uint16_t, capacity);
+    if (!v->data)
+        return 0;
+    return 1;
+}
+
+void
+half_array_free(half_array *v)
+{
+    PyMem_Free(v->data);
+    v->capacity = 0;
+}
@@ -40,32 +40,44 @@ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON A
 #define UPPER_MASK 0x80000000U  // Most significant w-r bits
 #define LOWER_MASK 0x7fffffffU  // Least significant r bits
 
-extern uint32_t mt[N];  // The array for the state vector
-extern int mti;         // mti == N+1 means mt[N] is not initialized
+typedef struct {
+    uint32_t mt[N]; // The array for the state vector
+    int mti;        // mti == N+1 means mt[N] is not initialized
+} MTState;
+
+// Seeded once at import, hands out the seeds of unseeded managers and systems
+// so that ones created in the same second still get distinct streams
+extern MTState default_seeds;
 
 // Initialize the generator from a seed
 static void
-init_genrand(uint32_t s)
+init_genrand(MTState *state, uint32_t s)
 {
+    uint32_t *mt = state->mt;
+    int mti;
+
     mt[0] = s & 0xffffffffU;
     for (mti = 1; mti < N; mti++) {
         mt[mti] = (1812433253U * (mt[mti - 1] ^ (mt[mti - 1] >> 30)) + mti);
         mt[mti] &= 0xffffffffU;  // For >32 bit machines
     }
+
+    state->mti = mti;
 }
 
 // Generate a random number on [0, 0xffffffff]-interval
 static uint32_t
-genrand_int32(void)
+genrand_int32(MTState *state)
 {
+    uint32_t *mt = state->mt;
     uint32_t y;
 
-    if (mti >= N) {  // Generate N words at one time
+    if (state->mti >= N) {  // Generate N words at one time
         static const uint32_t mag01[2] = {0x0U, MATRIX_A};
         int kk;
 
-        if (mti == N + 1)
-            init_genrand(5489U);
+        if (state->mti == N + 1)
+            init_genrand(state, 5489U);
 
         for (kk = 0; kk < N - M; kk++) {
             y = (mt[kk] & UPPER_MASK) | (mt[kk + 1] & LOWER_MASK);
@@ -78,10 +90,10 @@ genrand_int32(void)
         y = (mt[N - 1] & UPPER_MASK) | (mt[0] & LOWER_MASK);
         mt[N - 1] = mt[M - 1] ^ (y >> 1) ^ mag01[y & 0x1U];
 
-        mti = 0;
+        state->mti = 0;
     }
 
-    y = mt[mti++];
+    y = mt[state->mti++];
 
     // Tempering
     y ^= (y >> 11);
@@ -94,22 +106,22 @@ genrand_int32(void)
 
 // Generate a random number on [0,1]-real-interval
 static float
-rand_f(void)
+rand_f(MTState *state)
 {
-    return (float)(genrand_int32() * (1.0 / 4294967295.0));  // Dividing by 2^32-1
+    return (float)(genrand_int32(state) * (1.0 / 4294967295.0));  // Dividing by 2^32-1
 }
 
 static float
-rand_between(float lo, float hi)
+rand_between(MTState *state, float lo, float hi)
 {
-    return (float)(lo + (hi - lo) * rand_f());
+    return (float)(lo + (hi - lo) * rand_f(state));
 }
 
 static int
-rand_int_between(int lo, int hi)
+rand_int_between(MTState *state, int lo, int hi)
 {
     /* Returns a random integer in the range [lo, hi] */
-    return (int)(lo + (genrand_int32() % (hi - lo + 1)));
+    return (int)(lo + (genrand_int32(state) % (hi - lo + 1)));
 }
 
 typedef struct {
@@ -120,7 +132,7 @@ typedef struct {
 } generator;
 
 static float
-genrand_from(const generator *g)
+genrand_from(MTState *state, const generator *g)
 {
-    return g->randomize ? rand_between(g->min, g->max) : g->min;
+    return g->randomize ? rand_between(state, g->min, g->max) : g->min;
 }
@@ -83,6 +83,22 @@ IntFromObj(PyObject *obj, int *val)
     return 1;
 }
 
+static FORCEINLINE int
+SeedFromObj(PyObject *obj, uint32_t *val)
+{
+    if (!PyLong_Check(obj))
+        return 0;
+
+    /* Arbitrary sized ints are accepted and folded to the generator's 32 bits */
+    *val = (uint32_t)PyLong_AsUnsignedLongMask(obj);
+    if (PyErr_Occurred()) {
+        PyErr_Clear();
+        return 0;
+    }
+
+    return 1;
+}
+
 static FORCEINLINE int
 _IntFromObjIndex(PyObject *obj, int index, int *val)
 {
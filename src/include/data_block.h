@@ -1,8 +1,16 @@
 #pragma once
 
+#include <math.h>
+
 #include "float_array.h"
+#include "half_float.h"
 #include "MT19937.h"
 #include "emitter.h"
+#include "particle_effect.h"
+#include "noise.h"
+#include "profiler.h"
+#include "scratch_arena.h"
+#include "tracer.h"
 
 #define UNROLL_2(x) \
     x;              \
@@ -26,71 +34,252 @@ typedef struct {
 
 typedef struct {
     uint32_t *pixels;
-    int width, rows, src_offset;
+    const uint32_t *src; /* first source pixel, inside the block's blit atlas */
+    int width, rows;
 } BlitDestination;
 
+/* Only valid during a draw, the arrays live in the draw's scratch arena */
 typedef struct {
     Fragment *fragments;
+    int *frame_starts; /* first particle of each frame, num_frames + 1 entries */
     BlitDestination *destinations;
     int used_f;
-    int alloc_f;
     int dest_count;
+    int streamed;            /* sprites blitted right away, with no record */
+    int64_t streamed_pixels; /* their area, for the profiler */
 } FragmentationMap;
 
+/* Blits one whole sprite of the atlas, dst_pitch is in pixels */
+typedef void (*SpriteBlitter)(const SpriteAtlas *atlas, const uint32_t *src,
+                              uint32_t *dst, int width, int rows, int dst_pitch);
+
+/* A line already clipped to the surface, coordinates are 16.16 fixed point.
+ * One of the steps is a whole pixel, so no pixel is visited twice */
+typedef struct {
+    int32_t x, y;           /* first pixel */
+    int32_t step_x, step_y; /* from one pixel to the next */
+    int count;
+    uint32_t color; /* in the atlas' layout */
+} Streak;
+
+/* Draws one streak into pixels, pitch is in pixels */
+typedef void (*StreakRasterizer)(const SpriteAtlas *atlas, const Streak *streak,
+                                 uint32_t *pixels, int pitch);
+
+typedef enum {
+    _FALLOFF_LINEAR,
+    _FALLOFF_INVERSE_SQUARE,
+} AttractorFalloff;
+
+typedef struct {
+    vec2 position;
+    float strength; /* > 0 attracts, < 0 repels */
+    float radius;   /* no influence past this distance */
+    AttractorFalloff falloff;
+} Attractor;
+
+typedef struct {
+    uint8_t *cells;      /* one byte per cell, non-zero means solid */
+    int width, height;   /* grid size in cells */
+    float inv_cell_size; /* cells per pixel */
+    float restitution;
+    CollisionResponse response;
+} OccupancyGrid;
+
+static FORCEINLINE bool
+grid_cell_solid(const OccupancyGrid *grid, float x, float y)
+{
+    const int cx = (int)floorf(x * grid->inv_cell_size);
+    const int cy = (int)floorf(y * grid->inv_cell_size);
+
+    if (cx < 0 || cx >= grid->width || cy < 0 || cy >= grid->height)
+        return false;
+
+    return grid->cells[cy * grid->width + cx] != 0;
+}
+
+static FORCEINLINE bool
+outside_bounds(const CollisionBounds *bounds, float x, float y)
+{
+    return x < bounds->left || x > bounds->right || y < bounds->top ||
+           y > bounds->bottom;
+}
+
+/* Manager level state every DataBlock update can read from */
+typedef struct {
+    const Attractor *attractors;
+    int attractors_count;
+    const OccupancyGrid *grid; /* NULL if no collision map is set */
+    Profiler *prof;            /* NULL if profiling is disabled */
+    Tracer *tracer;            /* NULL if no trace is running */
+} UpdateContext;
+
+/* Manager level state every DataBlock draw can read from */
+typedef struct {
+    Profiler *prof;  /* NULL if profiling is disabled */
+    Tracer *tracer;  /* NULL if no trace is running */
+    float lead_time; /* time positions are projected ahead of the last update */
+    int stride;      /* only every stride-th particle is drawn, 1 draws all */
+    ScratchArena *scratch; /* backs each block's fragmentation map in turn */
+    /* Record every visible sprite instead of blitting it while the map is
+     * built, for callers that blit the map themselves */
+    bool materialize;
+} DrawContext;
+
+/* Terms an updater is specialized on, a block's mask indexes the updater tables.
+ * A new term takes the next bit, which doubles _UPDATE_MASK_COUNT and the list
+ * in DEFINE_UPDATER_TABLE, and one branch in every body */
+typedef enum {
+    _UPDATE_ACC_X = 1 << 0,
+    _UPDATE_ACC_Y = 1 << 1,
+    _UPDATE_COMPACT = 1 << 2,    /* accelerations are read as half floats */
+    _UPDATE_MASK_COUNT = 1 << 3, /* one past the highest mask */
+} UpdateFeatures;
+
+struct DataBlock;
+
+typedef void (*Updater)(struct DataBlock *, float);
+
+#define _UPDATER_VARIANT(body, mask)                      \
+    static void body##_##mask(DataBlock *block, float dt) \
+    {                                                     \
+        body(block, dt, mask);                            \
+    }
+
+#define _UPDATER_LIST(body) \
+    body##_0, body##_1, body##_2, body##_3, body##_4, body##_5, body##_6, body##_7
+
+#define _UPDATER_COUNT(body) \
+    (sizeof((Updater[]){_UPDATER_LIST(body)}) / sizeof(Updater))
+
+/* Stamps out one updater per feature mask from body(block, dt, features), the
+ * mask is a constant in each so every branch on it folds away. The list is
+ * counted on its own, the table takes its size from the extern declaration */
+#define DEFINE_UPDATER_TABLE(table, body)                         \
+    _UPDATER_VARIANT(body, 0)                                     \
+    _UPDATER_VARIANT(body, 1)                                     \
+    _UPDATER_VARIANT(body, 2)                                     \
+    _UPDATER_VARIANT(body, 3)                                     \
+    _UPDATER_VARIANT(body, 4)                                     \
+    _UPDATER_VARIANT(body, 5)                                     \
+    _UPDATER_VARIANT(body, 6)                                     \
+    _UPDATER_VARIANT(body, 7)                                     \
+    _Static_assert(_UPDATER_COUNT(body) == _UPDATE_MASK_COUNT,    \
+                   #table " needs one updater per feature mask"); \
+    const Updater table[_UPDATE_MASK_COUNT] = {_UPDATER_LIST(body)};
+
 typedef struct DataBlock {
     float_array positions_x;
     float_array positions_y;
-    float_array velocities_x;
+    float_array velocities_x; /* NULL data while the block is at rest */
     float_array velocities_y;
     float_array accelerations_x;
     float_array accelerations_y;
-    float_array lifetimes;
-    float_array max_lifetimes;
-    int *animation_indices;
+    half_array accelerations_x_h; /* used in place of the above when compact */
+    half_array accelerations_y_h;
+    /* Particle i dies once age reaches max_lifetimes[i], so the block's clock is
+     * the only thing that ticks and no per-particle lifetime is stored */
+    float_array max_lifetimes; /* NULL data when every particle shares one */
+    float max_lifetime;        /* the shared max lifetime, if so */
+    float age; /* time since spawn, the same for every particle */
+
+    /* Rotation and scale, like the lifetime each channel is NULL data when
+     * every particle shares the value below. Angles are evaluated at age */
+    float_array angles;             /* degrees at spawn */
+    float_array angular_velocities; /* degrees per time unit */
+    float_array scales;
+    float angle, angular_velocity, scale;
+    SpriteVariants *variants; /* shared with the Emitter, NULL if unused */
+    float streak; /* drawn as lines this long in time instead of sprites if > 0 */
 
     int num_frames;
-    PyObject *animation;
+    SpriteAtlas *atlas; /* shared with the Emitter, reference counted */
     FragmentationMap frag_map;
 
     int blend_mode;
     bool ended;
+    bool compact;
+    /* positions and velocities keep their spawn values and the positions are
+     * evaluated at age when drawing, until a force needs them integrated */
+    bool analytic;
+
+    NoiseSettings noise;
+    float noise_offset; /* lattice scroll offset, wraps at the lattice size */
+
+    CollisionBounds bounds;
 
     int particles_count;
-    void (*updater)(struct DataBlock *, float);
+    Updater updater;
 } DataBlock;
 
+/* Age, relative to a particle's max lifetime, at which it reaches frame k.
+ * Every frame search compares against this exact value */
+static FORCEINLINE float
+frame_fraction(int k, int num_frames)
+{
+    return (float)k / (float)num_frames;
+}
+
+/* Atlas the block's sprites are blitted from */
+static FORCEINLINE const SpriteAtlas *
+block_blit_atlas(const DataBlock *block)
+{
+    return block->variants ? block->variants->atlas : block->atlas;
+}
+
 /* ====================| Public facing DataBlock functions |==================== */
 int
-init_data_block(DataBlock *block, Emitter *emitter, vec2 position);
+init_data_block(DataBlock *block, Emitter *emitter, vec2 position, MTState *rng);
 
 void
 dealloc_data_block(DataBlock *block);
 
+Py_ssize_t
+data_block_allocated_bytes(const DataBlock *block);
+
 void
 choose_and_set_update_function(DataBlock *block, Emitter *emitter);
 
 void
-update_data_block(DataBlock *block, float dt);
+update_data_block(DataBlock *block, float dt, const UpdateContext *ctx);
 
 int
-draw_data_block(DataBlock *block, pgSurfaceObject *dest, const int blend_flag);
+draw_data_block(DataBlock *block, pgSurfaceObject *dest, const int blend_flag,
+                const DrawContext *ctx);
 
 /* ====================| Internal DataBlock functions |==================== */
 
 int
-init_fragmentation_map(DataBlock *block);
-
-void
-dealloc_fragmentation_map(FragmentationMap *frag_map);
+prepare_fragmentation_map(DataBlock *block, ScratchArena *scratch, bool materialize);
 
 void
 calculate_surface_index_occurrences(DataBlock *block);
 
 int
-populate_destinations_array(pgSurfaceObject *dest, DataBlock *block);
+populate_destinations_array(pgSurfaceObject *dest, DataBlock *block, float lead,
+                            int stride, SpriteBlitter blit);
 
 int
-calculate_fragmentation_map(pgSurfaceObject *dest, DataBlock *block);
+calculate_fragmentation_map(pgSurfaceObject *dest, DataBlock *block,
+                            const DrawContext *ctx);
+
+SpriteBlitter
+choose_sprite_blitter(int blend_flag);
+
+int
+populate_streaks(pgSurfaceObject *dest, DataBlock *block, float lead, int stride,
+                 StreakRasterizer draw);
+
+StreakRasterizer
+choose_streak_rasterizer(int blend_flag, int pitch);
+
+void
+draw_streak_copy(const SpriteAtlas *atlas, const Streak *streak, uint32_t *pixels,
+                 int pitch);
+
+void
+blit_sprite_copy(const SpriteAtlas *atlas, const uint32_t *src, uint32_t *dst,
+                 int width, int rows, int dst_pitch);
 
 void
 blit_fragments_blitcopy(FragmentationMap *frag_map, pgSurfaceObject *dest,
@@ -108,42 +297,72 @@ int
 alloc_and_init_positions(DataBlock *block, Emitter *emitter, vec2 position);
 
 int
-alloc_and_init_velocities(DataBlock *block, Emitter *emitter);
+alloc_and_init_velocities(DataBlock *block, Emitter *emitter, MTState *rng);
+
+int
+alloc_resting_velocities(DataBlock *block);
 
 int
-alloc_and_init_accelerations(DataBlock *block, Emitter *emitter);
+alloc_and_init_accelerations(DataBlock *block, Emitter *emitter, MTState *rng);
 
 int
-alloc_and_init_lifetimes(DataBlock *block, Emitter *emitter);
+alloc_and_init_lifetimes(DataBlock *block, Emitter *emitter, MTState *rng);
 
 int
-alloc_and_init_animation_indices(DataBlock *block, Emitter *emitter);
+alloc_and_init_transforms(DataBlock *block, Emitter *emitter, MTState *rng);
+
+extern const Updater updaters_scalar[_UPDATE_MASK_COUNT];
 
 void
-update_with_acceleration(DataBlock *block, float dt);
+apply_attractors_scalar(DataBlock *block, const Attractor *attractors, int count,
+                        float dt);
 
 void
-update_with_no_acceleration(DataBlock *block, float dt);
+apply_attractors(DataBlock *block, const Attractor *attractors, int count, float dt);
 
 void
-update_with_acceleration_x(DataBlock *block, float dt);
+apply_noise_scalar(DataBlock *block, float dt);
 
 void
-update_with_acceleration_y(DataBlock *block, float dt);
+apply_noise(DataBlock *block, float dt);
 
 void
-update_indices_scalar(DataBlock *block);
+find_frame_boundaries_scalar(const DataBlock *block, int *starts);
 
 void
-update_indices(DataBlock *block);
+find_frame_boundaries(const DataBlock *block, int *starts);
 
 void
 recalculate_particle_count(DataBlock *block);
 
+int
+collide_bounds_scalar(DataBlock *block, const CollisionBounds *bounds);
+
+int
+collide_bounds(DataBlock *block, const CollisionBounds *bounds);
+
+int
+collide_grid_scalar(DataBlock *block, const OccupancyGrid *grid, float dt);
+
+int
+collide_grid(DataBlock *block, const OccupancyGrid *grid, float dt);
+
+void
+remove_killed_particles(DataBlock *block, int first, const CollisionBounds *bounds,
+                        const OccupancyGrid *grid);
+
+void
+blit_sprite_add_scalar(const SpriteAtlas *atlas, const uint32_t *src, uint32_t *dst,
+                       int width, int rows, int dst_pitch);
+
 void
-blit_fragments_add_scalar(FragmentationMap *frag_map, PyObject **animation,
+blit_fragments_add_scalar(FragmentationMap *frag_map, const SpriteAtlas *atlas,
                           int dst_skip);
 
+void
+draw_streak_add_scalar(const SpriteAtlas *atlas, const Streak *streak,
+                       uint32_t *pixels, int pitch);
+
 int FORCEINLINE
 RectEmpty(const SDL_Rect *r);
 
@@ -16,13 +16,23 @@ typedef struct {
 
 int
 init_effect_instance(EffectInstance *instance, ParticleEffect *effect,
-                     vec2 position);
+                     vec2 position, float spawn_scale, MTState *rng);
 
 void
-update_effect_instance(EffectInstance *instance, float dt);
+update_effect_instance(EffectInstance *instance, float dt, const UpdateContext *ctx);
 
 int
-draw_effect_instance(EffectInstance *instance, pgSurfaceObject *dest);
+draw_effect_instance(EffectInstance *instance, pgSurfaceObject *dest,
+                     const DrawContext *ctx);
+
+/* Runs steps updates of every block, drawing each one right after its last
+ * step while its particles are still in cache. Time spent drawing is added to
+ * draw_ticks */
+int
+update_and_draw_effect_instance(EffectInstance *instance, float dt, int steps,
+                                const UpdateContext *update_ctx,
+                                pgSurfaceObject *dest, const DrawContext *draw_ctx,
+                                uint64_t *draw_ticks);
 
 void
 dealloc_effect_instance(EffectInstance *g);
@@ -3,11 +3,18 @@
 #include <stdbool.h>
 #include "MT19937.h"
 #include "base.h"
+#include "sprite_atlas.h"
 
 typedef enum {
     _POINT,
 } EmitterSpawnShape;
 
+typedef struct {
+    float strength;  /* peak velocity added by the noise field */
+    float frequency; /* lattice cells per pixel */
+    float scroll;    /* lattice cells scrolled per time unit */
+} NoiseSettings;
+
 typedef struct {
     /* Emitter type data */
     EmitterSpawnShape spawn_shape;
@@ -18,15 +25,30 @@ typedef struct {
     /* Core particle settings */
     PyObject *animation; /* python tuple containing animation frames */
     int num_frames;      /* animation frames number */
+    SpriteAtlas *atlas;  /* the frames packed for blitting */
 
     generator lifetime;
     generator speed_x;
     generator speed_y;
     generator acceleration_x;
     generator acceleration_y;
+    generator angle;            /* degrees, counterclockwise */
+    generator angular_velocity; /* degrees per time unit */
+    generator scale;
 
     /* Additional particle settings */
     int blend_mode;
+    NoiseSettings noise;
+    bool compact; /* store the accelerations as half floats */
+    /* Evaluate positions in closed form instead of integrating. Under
+     * acceleration that's the exact path, the updaters' semi-implicit steps
+     * run a * t * dt / 2 ahead of it */
+    bool analytic;
+    /* Draw lines back to where the particles were this long ago instead of
+     * their sprites, 0 draws the sprites */
+    float streak;
+    /* Rotated and scaled frames, NULL if the particles do neither */
+    SpriteVariants *variants;
 } Emitter;
 
 typedef struct {
@@ -2,6 +2,7 @@
 
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <stdint.h>
 
 typedef struct {
     float *data;
@@ -16,3 +17,15 @@ float_array_calloc(float_array *v, Py_ssize_t capacity);
 
 void
 float_array_free(float_array *v);
+
+/* IEEE 754 half precision storage, see half_float.h for the conversions */
+typedef struct {
+    uint16_t *data;
+    Py_ssize_t capacity;
+} half_array;
+
+int
+half_array_alloc(half_array *v, Py_ssize_t capacity);
+
+void
+half_array_free(half_array *v);
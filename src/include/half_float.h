@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string.h>
+#include "base.h"
+
+/* Scalar IEEE 754 binary16 conversions. Widening is exact, so it matches
+ * _mm256_cvtph_ps bit for bit, narrowing rounds to nearest even like F16C */
+
+static FORCEINLINE float
+half_to_float(uint16_t h)
+{
+    /* Moving exponent and mantissa into place and scaling by 2^112 rebiases
+     * the exponent, and turns half subnormals (single subnormals once shifted)
+     * into the matching normal floats, both exactly. Only inf and nan need
+     * their exponent saturated by hand */
+    const uint32_t expmant = h & 0x7FFF;
+    uint32_t bits = expmant << 13;
+    float f;
+
+    memcpy(&f, &bits, sizeof(f));
+    f *= 5.192296858534827628530496329220096e33f; /* 2^112 */
+    memcpy(&bits, &f, sizeof(bits));
+
+    if (expmant > 0x7BFF)
+        bits |= 0x7F800000;
+
+    bits |= (uint32_t)(h & 0x8000) << 16;
+
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static FORCEINLINE uint16_t
+float_to_half(float f)
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+
+    const uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+    x &= 0x7FFFFFFF;
+
+    if (x >= 0x7F800000) /* inf / nan, nans are kept quiet */
+        return sign | 0x7C00 | (x > 0x7F800000 ? 0x200 : 0);
+
+    if (x >= 0x477FF000) /* rounds past the largest half */
+        return sign | 0x7C00;
+
+    if (x < 0x38800000) {
+        /* subnormal result, scale to units of 2^-24 and let the FPU round the
+         * mantissa to nearest even through the 1.5 * 2^23 magic number */
+        float a;
+        memcpy(&a, &x, sizeof(a));
+        a = (a * 16777216.0f + 12582912.0f) - 12582912.0f;
+        return sign | (uint16_t)a;
+    }
+
+    /* rebias the exponent by -112 and round the dropped 13 bits to even */
+    x += 0xC8000FFF + ((x >> 13) & 1);
+    return sign | (uint16_t)(x >> 13);
+}
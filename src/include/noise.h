@@ -0,0 +1,17 @@
+#pragma once
+
+#include "base.h"
+
+/* The lattice must be a power of two in size so the sampling code can wrap
+ * coordinates with a mask instead of a modulo */
+#define NOISE_LATTICE_BITS 6
+#define NOISE_LATTICE_SIZE (1 << NOISE_LATTICE_BITS)
+#define NOISE_LATTICE_MASK (NOISE_LATTICE_SIZE - 1)
+
+/* Tileable 2D curl-noise velocity field, stored as two planes so SIMD gathers
+ * fetch one component at a time */
+extern float curl_noise_x[NOISE_LATTICE_SIZE * NOISE_LATTICE_SIZE];
+extern float curl_noise_y[NOISE_LATTICE_SIZE * NOISE_LATTICE_SIZE];
+
+void
+init_curl_noise_lattice(void);
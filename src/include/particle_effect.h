@@ -2,9 +2,24 @@
 
 #include "emitter.h"
 
+typedef enum {
+    _COLLISION_BOUNCE,
+    _COLLISION_KILL,
+} CollisionResponse;
+
+typedef struct {
+    float left, top, right, bottom;
+    float restitution; /* fraction of the normal velocity kept on a bounce */
+    float friction;    /* fraction of the tangential velocity lost on a bounce */
+    CollisionResponse response;
+    bool in_use;
+} CollisionBounds;
+
 typedef struct {
-    PyObject *emitters; /* emitters tuple */
-    int emitters_count; /* number of emitters */
+    PyObject *emitters;     /* emitters tuple */
+    int emitters_count;     /* number of emitters */
+    CollisionBounds bounds; /* particles are kept inside this rect */
+    MTState *rng; /* own random stream if seeded, NULL to use the manager's */
 } ParticleEffect;
 
 typedef struct {
@@ -6,13 +6,56 @@
 #include <math.h>
 
 #define PM_BASE_BLOCK_SIZE 10
+#define PM_DEFAULT_MAX_ATTRACTORS 16
+#define PM_MAX_SUBSTEPS 8 /* fixed steps run by one update(), the rest is dropped */
+#define PM_MAX_DRAW_STRIDE 16 /* sparsest decimation a draw budget can reach */
 
-typedef struct {
+/* update() runs without the GIL, anything it reads must not be touched by
+ * another thread meanwhile */
+#define PM_UPDATING_CHECK(self)                                                 \
+    if ((self)->updating) {                                                     \
+        PyErr_SetString(PyExc_RuntimeError,                                     \
+                        "The ParticleManager is being updated");                \
+        return NULL;                                                            \
+    }
+
+struct ParticleSystem;
+
+typedef struct ParticleManager {
     PyObject_HEAD EffectInstance *instances;
     Py_ssize_t allocated_instances;
     Py_ssize_t used_instances;
+
+    Attractor *attractors;
+    Py_ssize_t allocated_attractors;
+    Py_ssize_t used_attractors;
+    int max_attractors; /* max number of attractors evaluated per update */
+
+    OccupancyGrid *grid; /* static collision map, NULL if not set */
+
+    MTState rng; /* random stream used by effects that aren't seeded */
+
+    Profiler prof;  /* counters since the last stats() call */
+    bool profiling; /* prof is only filled while this is set */
+
+    Tracer *tracer;       /* running trace, NULL if none */
+    PyObject *trace_path; /* bytes path the trace is written to on stop */
+
+    float fixed_dt;    /* substep size, 0 to step by the dt given to update() */
+    float accumulator; /* time received but not simulated yet, < fixed_dt */
+    bool updating;     /* set while update() runs with the GIL released */
+
+    Py_ssize_t max_particles; /* particle budget, 0 for none */
+    int64_t max_draw_ns;      /* draw time budget, 0 for none */
+    int draw_stride;          /* decimation picked from the last draw times */
+
+    ScratchArena scratch; /* fragmentation maps of the block being drawn */
+
+    struct ParticleSystem *system; /* the system it was created from, or NULL */
 } ParticleManager;
 
+extern PyTypeObject ParticleManagerType;
+
 PyObject *
 pm_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
 
@@ -22,8 +65,50 @@ pm_dealloc(ParticleManager *self);
 /* =======================| INTERNAL FUNCTIONALITY |======================= */
 
 int
-_pm_spawn_effect_helper(EffectInstance *instance, PyObject *const *args,
-                        Py_ssize_t nargs);
+_pm_spawn_effect_helper(ParticleManager *self, EffectInstance *instance,
+                        PyObject *const *args, Py_ssize_t nargs);
+
+int
+_pm_take_steps(ParticleManager *self, float dt, float *step_dt);
+
+UpdateContext
+_pm_update_context(ParticleManager *self);
+
+int
+_pm_prepare_update(ParticleManager *self, const UpdateContext *ctx);
+
+void
+_pm_remove_ended(ParticleManager *self);
+
+pgSurfaceObject *
+_pm_draw_target(PyObject *arg);
+
+DrawContext
+_pm_draw_context(ParticleManager *self);
+
+Py_ssize_t
+_pm_get_num_particles(ParticleManager *self);
+
+float
+_pm_spawn_scale(ParticleManager *self, ParticleEffect *effect);
+
+int
+_pm_draw_stride(ParticleManager *self);
+
+void
+_pm_adapt_draw_stride(ParticleManager *self, uint64_t ticks);
+
+void
+_pm_free_grid(ParticleManager *self);
+
+void
+_pm_free_trace(ParticleManager *self);
+
+int
+_pm_fill_grid_from_mask(OccupancyGrid *grid, PyObject *mask);
+
+int
+_pm_fill_grid_from_buffer(OccupancyGrid *grid, PyObject *obj, int bits);
 
 /* ======================================================================== */
 
@@ -36,9 +121,54 @@ pm_update(ParticleManager *self, PyObject *arg);
 PyObject *
 pm_draw(ParticleManager *self, PyObject *arg);
 
+PyObject *
+pm_update_and_draw(ParticleManager *self, PyObject *const *args, Py_ssize_t nargs);
+
+PyObject *
+pm_add_attractor(ParticleManager *self, PyObject *args, PyObject *kwds);
+
+PyObject *
+pm_clear_attractors(ParticleManager *self, PyObject *_null);
+
+PyObject *
+pm_set_collision_map(ParticleManager *self, PyObject *args, PyObject *kwds);
+
+PyObject *
+pm_clear_collision_map(ParticleManager *self, PyObject *_null);
+
+PyObject *
+pm_set_budget(ParticleManager *self, PyObject *args, PyObject *kwds);
+
+PyObject *
+pm_stats(ParticleManager *self, PyObject *_null);
+
+PyObject *
+pm_start_trace(ParticleManager *self, PyObject *arg);
+
+PyObject *
+pm_stop_trace(ParticleManager *self, PyObject *_null);
+
+PyObject *
+pm_get_profiling(ParticleManager *self, void *closure);
+
+int
+pm_set_profiling(ParticleManager *self, PyObject *value, void *closure);
+
 PyObject *
 pm_str(ParticleManager *self);
 
 PyObject *
 pm_get_num_particles(ParticleManager *self, void *closure);
+
+PyObject *
+pm_get_max_attractors(ParticleManager *self, void *closure);
+
+int
+pm_set_max_attractors(ParticleManager *self, PyObject *value, void *closure);
+
+PyObject *
+pm_get_fixed_timestep(ParticleManager *self, void *closure);
+
+int
+pm_set_fixed_timestep(ParticleManager *self, PyObject *value, void *closure);
 /* ===================================================================== */
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "particle_manager.h"
+#include "worker_pool.h"
+
+/* Every worker plus the calling thread must fit in a trace */
+#define PS_MAX_WORKERS (TRACE_MAX_THREADS - 1)
+
+/* Shared context for layered managers. It owns the worker threads that update
+ * every manager created from it in a single batch, and the random stream the
+ * managers are seeded from. Sprite atlases are already shared process wide */
+typedef struct ParticleSystem {
+    PyObject_HEAD WorkerPool pool;
+    SDL_mutex *merge_lock; /* guards the managers' profilers during a batch */
+
+    MTState rng; /* seeds the managers created from this system */
+
+    /* Borrowed, a manager keeps its system alive and removes itself from
+     * here when deallocated */
+    ParticleManager **managers;
+    Py_ssize_t used_managers;
+    Py_ssize_t allocated_managers;
+
+    bool updating; /* set while update() runs with the GIL released */
+} ParticleSystem;
+
+extern PyTypeObject ParticleSystemType;
+
+PyObject *
+ps_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+void
+ps_dealloc(ParticleSystem *self);
+
+/* =======================| INTERNAL FUNCTIONALITY |======================= */
+
+void
+particle_system_remove_manager(ParticleSystem *self, ParticleManager *manager);
+
+/* ======================================================================== */
+
+PyObject *
+ps_create_manager(ParticleSystem *self, PyObject *_null);
+
+PyObject *
+ps_update(ParticleSystem *self, PyObject *arg);
+
+PyObject *
+ps_str(ParticleSystem *self);
+
+PyObject *
+ps_get_workers(ParticleSystem *self, void *closure);
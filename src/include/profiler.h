@@ -0,0 +1,51 @@
+#pragma once
+
+#include "base.h"
+
+/* Timed phases of a frame, in the order they run */
+typedef enum {
+    _PHASE_FORCES,          /* attractors and noise */
+    _PHASE_UPDATE,          /* position/velocity/lifetime integration */
+    _PHASE_COLLISIONS,      /* bounds and occupancy grid collisions */
+    _PHASE_PARTICLE_COUNT,  /* recalculate_particle_count */
+    _PHASE_OCCURRENCES,     /* calculate_surface_index_occurrences */
+    _PHASE_DESTINATIONS,    /* populate_destinations_array, materialized only */
+    _PHASE_BLIT,            /* blit_fragments, or the streamed populate loop */
+    _PHASE_COUNT,
+} ProfilerPhase;
+
+/* Per manager counters. Kernels receive a NULL Profiler when profiling is
+ * disabled, so the cost then is a single branch per phase and block */
+typedef struct {
+    uint64_t ticks[_PHASE_COUNT]; /* SDL performance counter ticks */
+    int64_t particles_updated;
+    int64_t particles_culled;    /* alive particles entirely off the surface */
+    int64_t particles_decimated; /* alive particles skipped by a draw budget */
+    int64_t destinations;        /* blits emitted */
+    int64_t pixels_blended;      /* destination pixels written */
+    int64_t bytes_allocated;     /* spawned particle data and draw scratch */
+} Profiler;
+
+static FORCEINLINE uint64_t
+prof_begin(const Profiler *prof)
+{
+    return prof ? SDL_GetPerformanceCounter() : 0;
+}
+
+static FORCEINLINE void
+prof_end(Profiler *prof, ProfilerPhase phase, uint64_t start)
+{
+    if (prof)
+        prof->ticks[phase] += SDL_GetPerformanceCounter() - start;
+}
+
+void
+profiler_reset(Profiler *prof);
+
+/* Adds the counters of src to dst, used to fold per thread profilers */
+void
+profiler_merge(Profiler *dst, const Profiler *src);
+
+/* Returns a new dict with every counter, timers converted to nanoseconds */
+PyObject *
+profiler_as_dict(const Profiler *prof);
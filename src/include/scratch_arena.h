@@ -0,0 +1,29 @@
+#pragma once
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+/* Allocations start on the same boundary PyMem guarantees */
+#define SCRATCH_ALIGN 16
+#define SCRATCH_ROUND(size) \
+    (((size_t)(size) + SCRATCH_ALIGN - 1) & ~(size_t)(SCRATCH_ALIGN - 1))
+
+/* Bump allocator for data that only lives through one draw. The memory is kept
+ * across resets, so it settles at the biggest reservation seen */
+typedef struct {
+    char *data;
+    size_t used;
+    size_t capacity;
+} ScratchArena;
+
+/* Drops every allocation and makes room for size bytes, counted with
+ * SCRATCH_ROUND per allocation. Sets a MemoryError on failure */
+int
+scratch_arena_reset(ScratchArena *arena, size_t size);
+
+/* Carves size bytes out of the room made by the last reset */
+void *
+scratch_arena_alloc(ScratchArena *arena, size_t size);
+
+void
+scratch_arena_free(ScratchArena *arena);
@@ -15,50 +15,96 @@
 #define ENABLE_SSE_NEON 0
 #endif
 
+/* F16C shipped with every AVX2 CPU, so it relies on the AVX2 runtime check and
+ * only compile time support is tracked here. MSVC enables it with /arch:AVX2 */
+#if defined(__AVX2__) && (defined(__F16C__) || defined(_MSC_VER))
+#define ENABLE_F16C 1
+#else
+#define ENABLE_F16C 0
+#endif
+
+typedef enum {
+    _SIMD_NONE,
+    _SIMD_SSE2,
+    _SIMD_AVX2,
+} SIMDLevel;
+
+/* Highest instruction set the kernels are allowed to use. Lowering it forces
+ * the fallback paths, all of which produce bit-identical results */
+extern SIMDLevel max_simd_level;
+
 int
 _Has_AVX2();
 
 int
 _HasSSE_NEON();
 
+/* Index of the lowest set lane in a movemask result, mask must not be 0 */
+static FORCEINLINE int
+_first_lane(int mask)
+{
+    int lane = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        lane++;
+    }
+    return lane;
+}
+
 /* =============| AVX2 |============= */
 
-void
-update_with_acceleration_avx2(DataBlock *block, float dt);
+extern const Updater updaters_avx2[_UPDATE_MASK_COUNT];
 
 void
-update_with_no_acceleration_avx2(DataBlock *block, float dt);
+apply_attractors_avx2(DataBlock *block, const Attractor *attractors, int count,
+                      float dt);
 
 void
-update_with_acceleration_x_avx2(DataBlock *block, float dt);
+apply_noise_avx2(DataBlock *block, float dt);
 
-void
-update_with_acceleration_y_avx2(DataBlock *block, float dt);
+int
+collide_bounds_avx2(DataBlock *block, const CollisionBounds *bounds);
+
+int
+collide_grid_avx2(DataBlock *block, const OccupancyGrid *grid, float dt);
 
 void
-update_indices_avx2(DataBlock *block);
+blit_sprite_add_avx2(const SpriteAtlas *atlas, const uint32_t *src, uint32_t *dst,
+                     int width, int rows, int dst_pitch);
 
 void
-blit_fragments_add_avx2(FragmentationMap *frag_map, PyObject **animation,
+blit_fragments_add_avx2(FragmentationMap *frag_map, const SpriteAtlas *atlas,
                         int dst_skip);
 
+void
+draw_streak_add_avx2(const SpriteAtlas *atlas, const Streak *streak, uint32_t *pixels,
+                     int pitch);
+
 /* =============| SSE2 |============= */
 
-void
-update_with_acceleration_sse2(DataBlock *block, float dt);
+extern const Updater updaters_sse2[_UPDATE_MASK_COUNT];
 
 void
-update_with_no_acceleration_sse2(DataBlock *block, float dt);
+apply_attractors_sse2(DataBlock *block, const Attractor *attractors, int count,
+                      float dt);
 
 void
-update_with_acceleration_x_sse2(DataBlock *block, float dt);
+apply_noise_sse2(DataBlock *block, float dt);
 
-void
-update_with_acceleration_y_sse2(DataBlock *block, float dt);
+int
+collide_bounds_sse2(DataBlock *block, const CollisionBounds *bounds);
+
+int
+collide_grid_sse2(DataBlock *block, const OccupancyGrid *grid, float dt);
 
 void
-update_indices_sse2(DataBlock *block);
+blit_sprite_add_sse2(const SpriteAtlas *atlas, const uint32_t *src, uint32_t *dst,
+                     int width, int rows, int dst_pitch);
 
 void
-blit_fragments_add_sse2(FragmentationMap *frag_map, PyObject **animation,
+blit_fragments_add_sse2(FragmentationMap *frag_map, const SpriteAtlas *atlas,
                         int dst_skip);
+
+void
+draw_streak_add_sse2(const SpriteAtlas *atlas, const Streak *streak, uint32_t *pixels,
+                     int pitch);
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <math.h>
+#include <stdbool.h>
+
+#include "base.h"
+
+#define ATLAS_ALIGN 64   /* byte alignment of the pixel storage, a cache line */
+#define ATLAS_ROW_ALIGN 8 /* row pitch granularity in pixels, one AVX2 vector */
+#define ATLAS_CACHE_BUCKETS 64
+
+typedef struct {
+    int offset; /* index of the frame's top left pixel in the atlas */
+    int width, height;
+    uint32_t average; /* mean color of the lit pixels, what streaks are drawn in */
+} AtlasFrame;
+
+/* All the frames of an animation packed into one block of memory, stacked
+ * vertically and sharing the same padded row pitch. Atlases are cached by
+ * content at module level, so emitters with the same frames share one. */
+typedef struct SpriteAtlas {
+    uint32_t *pixels; /* ATLAS_ALIGN aligned */
+    void *memory;     /* the allocation pixels points into */
+    int pitch;        /* pixels per row, a multiple of ATLAS_ROW_ALIGN */
+    int num_frames;
+    int Ridx, Gidx, Bidx; /* byte index of each channel inside a pixel */
+    Uint32 format;        /* SDL pixel format of the source frames */
+    Py_ssize_t refcount;
+
+    uint64_t hash; /* content hash, the cache key */
+    struct SpriteAtlas *next; /* next atlas in the same cache bucket */
+
+    AtlasFrame frames[];
+} SpriteAtlas;
+
+/* Returns a new reference to an atlas holding the given frames, reusing a
+ * cached one if the same pixels were already packed */
+SpriteAtlas *
+sprite_atlas_from_frames(PyObject *const *frames, int num_frames);
+
+void
+sprite_atlas_incref(SpriteAtlas *atlas);
+
+void
+sprite_atlas_decref(SpriteAtlas *atlas);
+
+static FORCEINLINE uint32_t *
+atlas_frame_pixels(const SpriteAtlas *atlas, int frame)
+{
+    return atlas->pixels + atlas->frames[frame].offset;
+}
+
+/* Where a rendered variant sits and its pixels, once it was rendered */
+typedef struct {
+    int dx, dy; /* offset from the source frame's top left, centers line up */
+    uint32_t *pixels; /* ATLAS_ALIGN aligned, NULL until rendered */
+    void *memory;     /* the allocation pixels points into */
+} VariantSlot;
+
+/* Rotated and scaled copies of an atlas' frames, described as the frames of an
+ * atlas of their own so that they blit like any other sprite. Angles and
+ * scales are quantized to buckets and a copy is only allocated and rendered
+ * the first time it is drawn, which always happens with the GIL held */
+typedef struct {
+    SpriteAtlas *source; /* reference held */
+    /* One frame per slot sharing one pitch, not in the atlas cache. It has no
+     * pixels of its own, each slot holds its own */
+    SpriteAtlas *atlas;
+    int angle_steps;
+    int scale_steps;
+    float scale_min;  /* scale of the first bucket */
+    float scale_step; /* scale between two consecutive buckets */
+    Py_ssize_t refcount;
+
+    VariantSlot slots[]; /* see sprite_variant_slot() */
+} SpriteVariants;
+
+/* Returns a new reference, scale_max is ignored with a single scale step */
+SpriteVariants *
+sprite_variants_new(SpriteAtlas *source, int angle_steps, int scale_steps,
+                    float scale_min, float scale_max);
+
+void
+sprite_variants_incref(SpriteVariants *variants);
+
+void
+sprite_variants_decref(SpriteVariants *variants);
+
+/* Returns 0 with an error set if the slot's pixels can't be allocated */
+int
+sprite_variant_render(SpriteVariants *variants, int slot);
+
+/* Slot of the variant closest to the given angle, in degrees counterclockwise,
+ * and scale */
+static FORCEINLINE int
+sprite_variant_slot(const SpriteVariants *variants, int frame, float angle,
+                    float scale)
+{
+    float turns = angle * (1.0f / 360.0f);
+    turns -= floorf(turns);
+
+    /* Clamped before the conversion, MAX() turns a NaN from an angle that
+     * overflowed at runtime into 0 instead of an index outside the slots */
+    int a = (int)MIN(MAX(turns * variants->angle_steps + 0.5f, 0.0f),
+                     (float)variants->angle_steps);
+    if (a >= variants->angle_steps)
+        a = 0;
+
+    int s = 0;
+    if (variants->scale_steps > 1) {
+        const float bucket =
+            (scale - variants->scale_min) / variants->scale_step + 0.5f;
+        s = (int)MIN(MAX(bucket, 0.0f), (float)(variants->scale_steps - 1));
+    }
+
+    return (frame * variants->scale_steps + s) * variants->angle_steps + a;
+}
+
+/* The slot's pixels, laid out as variants->atlas->frames[slot] with the
+ * atlas' pitch and rendered on first use. NULL with an error set on failure */
+static FORCEINLINE const uint32_t *
+sprite_variant_pixels(SpriteVariants *variants, int slot)
+{
+    if (!variants->slots[slot].pixels && !sprite_variant_render(variants, slot))
+        return NULL;
+
+    return variants->slots[slot].pixels;
+}
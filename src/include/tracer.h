@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "base.h"
+
+#define TRACE_MAX_THREADS 64
+#define TRACE_RING_SIZE (1 << 16) /* events kept per thread, oldest dropped */
+
+typedef struct {
+    const char *name; /* static string, never copied */
+    uint64_t ts;      /* SDL performance counter ticks */
+    int arg;          /* instance or block index, -1 if none */
+    char phase;       /* 'B'egin or 'E'nd */
+} TraceEvent;
+
+/* Single producer ring, only ever written by the thread that claimed it */
+typedef struct {
+    SDL_atomic_t state; /* _RING_FREE -> _RING_CLAIMED -> _RING_READY */
+    SDL_threadID tid;
+    TraceEvent *events;
+    uint64_t written; /* total events ever written, the head is written % size */
+} TraceRing;
+
+typedef struct {
+    TraceRing rings[TRACE_MAX_THREADS];
+    uint64_t start; /* ticks at start_trace(), trace timestamps are relative */
+    SDL_atomic_t dropped; /* events lost because every ring was taken */
+} Tracer;
+
+Tracer *
+tracer_new(void);
+
+void
+tracer_free(Tracer *tracer);
+
+/* Records an event in the calling thread's ring. Lock free and allocation free
+ * except the first time a thread records into this tracer */
+void
+tracer_record(Tracer *tracer, const char *name, char phase, int arg);
+
+/* Writes every ring as Chrome trace-event JSON, loadable in Perfetto */
+int
+tracer_dump(const Tracer *tracer, const char *path);
+
+static FORCEINLINE void
+trace_begin(Tracer *tracer, const char *name, int arg)
+{
+    if (tracer)
+        tracer_record(tracer, name, 'B', arg);
+}
+
+static FORCEINLINE void
+trace_end(Tracer *tracer, const char *name)
+{
+    if (tracer)
+        tracer_record(tracer, name, 'E', -1);
+}
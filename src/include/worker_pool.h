@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "base.h"
+
+/* Runs job index i of a batch, called from any of the pool's threads */
+typedef void (*WorkerJob)(void *arg, int index);
+
+/* A fixed set of threads sleeping until a batch is submitted. Jobs are claimed
+ * one at a time through an atomic counter, so uneven jobs balance out */
+typedef struct {
+    SDL_Thread **threads;
+    int num_threads;
+
+    SDL_mutex *lock;
+    SDL_cond *wake; /* signaled when a batch is submitted or on shutdown */
+    SDL_cond *done; /* signaled when the last worker leaves a batch */
+
+    WorkerJob job;
+    void *arg;
+    int num_jobs;
+    SDL_atomic_t next; /* next job index to claim */
+    int busy;          /* workers that haven't left the current batch yet */
+    unsigned int generation;
+    bool quit;
+} WorkerPool;
+
+/* Starts num_threads workers, 0 makes every batch run on the calling thread.
+ * Must be called with the GIL held, sets a python error on failure */
+int
+worker_pool_init(WorkerPool *pool, int num_threads);
+
+/* Runs a batch to completion, the calling thread takes jobs too. Jobs must not
+ * touch python objects, the caller is expected to have released the GIL */
+void
+worker_pool_run(WorkerPool *pool, WorkerJob job, void *arg, int num_jobs);
+
+void
+worker_pool_free(WorkerPool *pool);
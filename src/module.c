@@ -1,12 +1,50 @@
 #include "include/particle_manager.h"
+#include "include/particle_system.h"
 #include "include/pygame.h"
 #include "include/emitter.h"
 #include "include/particle_effect.h"
+#include "include/noise.h"
+#include "include/simd_common.h"
 
 void **_PGSLOTS_surface;
-/* internal data for the random number generator */
-uint32_t mt[N];
-int mti = N + 1;
+SIMDLevel max_simd_level = _SIMD_AVX2;
+MTState default_seeds;
+
+/* ===================================================================== */
+static PyObject *
+set_simd_level(PyObject *module, PyObject *arg)
+{
+    int level;
+    if (!IntFromObj(arg, &level))
+        return RAISE(PyExc_TypeError, "Invalid level, must be an integer");
+
+    switch (level) {
+        case _SIMD_NONE:
+        case _SIMD_SSE2:
+        case _SIMD_AVX2:
+            break;
+        default:
+            return RAISE(PyExc_ValueError,
+                         "Invalid level, supported levels are: "
+                         "SIMD_NONE, SIMD_SSE2 and SIMD_AVX2");
+    }
+
+    /* Already spawned effects keep the updater they were created with */
+    max_simd_level = (SIMDLevel)level;
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+get_simd_level(PyObject *module, PyObject *_null)
+{
+    return PyLong_FromLong(max_simd_level);
+}
+
+static PyMethodDef itz_particle_manager_methods[] = {
+    {"set_simd_level", (PyCFunction)set_simd_level, METH_O, NULL},
+    {"get_simd_level", (PyCFunction)get_simd_level, METH_NOARGS, NULL},
+    {NULL, NULL, 0, NULL}};
 
 /* ===================================================================== */
 PyTypeObject Emitter_Type = {
@@ -36,13 +74,30 @@ static PyMethodDef ParticleManagerMethods[] = {
     {"spawn_effect", (PyCFunction)pm_spawn_effect, METH_FASTCALL, NULL},
     {"update", (PyCFunction)pm_update, METH_O, NULL},
     {"draw", (PyCFunction)pm_draw, METH_O, NULL},
+    {"update_and_draw", (PyCFunction)pm_update_and_draw, METH_FASTCALL, NULL},
+    {"add_attractor", (PyCFunction)pm_add_attractor, METH_VARARGS | METH_KEYWORDS,
+     NULL},
+    {"clear_attractors", (PyCFunction)pm_clear_attractors, METH_NOARGS, NULL},
+    {"set_collision_map", (PyCFunction)pm_set_collision_map,
+     METH_VARARGS | METH_KEYWORDS, NULL},
+    {"clear_collision_map", (PyCFunction)pm_clear_collision_map, METH_NOARGS, NULL},
+    {"set_budget", (PyCFunction)pm_set_budget, METH_VARARGS | METH_KEYWORDS,
+     NULL},
+    {"stats", (PyCFunction)pm_stats, METH_NOARGS, NULL},
+    {"start_trace", (PyCFunction)pm_start_trace, METH_O, NULL},
+    {"stop_trace", (PyCFunction)pm_stop_trace, METH_NOARGS, NULL},
     {NULL, NULL, 0, NULL}};
 
 static PyGetSetDef ParticleManagerAttributes[] = {
     {"num_particles", (getter)pm_get_num_particles, NULL, NULL, NULL},
+    {"max_attractors", (getter)pm_get_max_attractors,
+     (setter)pm_set_max_attractors, NULL, NULL},
+    {"profiling", (getter)pm_get_profiling, (setter)pm_set_profiling, NULL, NULL},
+    {"fixed_timestep", (getter)pm_get_fixed_timestep,
+     (setter)pm_set_fixed_timestep, NULL, NULL},
     {NULL, 0, NULL, NULL, NULL}};
 
-static PyTypeObject ParticleManagerType = {
+PyTypeObject ParticleManagerType = {
     PyVarObject_HEAD_INIT(NULL, 0).tp_name = "particle_manager.ParticleManager",
     .tp_doc = "Particle Manager",
     .tp_basicsize = sizeof(ParticleManager),
@@ -55,11 +110,34 @@ static PyTypeObject ParticleManagerType = {
     .tp_getset = ParticleManagerAttributes,
 };
 
+static PyMethodDef ParticleSystemMethods[] = {
+    {"create_manager", (PyCFunction)ps_create_manager, METH_NOARGS, NULL},
+    {"update", (PyCFunction)ps_update, METH_O, NULL},
+    {NULL, NULL, 0, NULL}};
+
+static PyGetSetDef ParticleSystemAttributes[] = {
+    {"workers", (getter)ps_get_workers, NULL, NULL, NULL},
+    {NULL, 0, NULL, NULL, NULL}};
+
+PyTypeObject ParticleSystemType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "particle_manager.ParticleSystem",
+    .tp_doc = "Particle System",
+    .tp_basicsize = sizeof(ParticleSystem),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = (newfunc)ps_new,
+    .tp_str = (reprfunc)ps_str,
+    .tp_repr = (reprfunc)ps_str,
+    .tp_dealloc = (destructor)ps_dealloc,
+    .tp_methods = ParticleSystemMethods,
+    .tp_getset = ParticleSystemAttributes,
+};
+
 static struct PyModuleDef itz_particle_manager_module = {
     PyModuleDef_HEAD_INIT,
     .m_name = "itz_particle_manager",
     .m_doc = "ItzPr4d4t0r's Particle Manager module",
     .m_size = -1,
+    .m_methods = itz_particle_manager_methods,
 };
 
 PyMODINIT_FUNC
@@ -67,6 +145,8 @@ PyInit_itz_particle_manager(void)
 {
     import_pygame_surface();
 
+    init_genrand(&default_seeds, (uint32_t)time(NULL));
+
     PyObject *module = PyModule_Create(&itz_particle_manager_module);
     if (!module)
         return NULL;
@@ -77,6 +157,12 @@ PyInit_itz_particle_manager(void)
     Py_INCREF(&ParticleManagerType);
     PyModule_AddObject(module, "ParticleManager", (PyObject *)&ParticleManagerType);
 
+    if (PyType_Ready(&ParticleSystemType) < 0)
+        return NULL;
+
+    Py_INCREF(&ParticleSystemType);
+    PyModule_AddObject(module, "ParticleSystem", (PyObject *)&ParticleSystemType);
+
     if (PyType_Ready(&Emitter_Type) < 0)
         return NULL;
 
@@ -92,7 +178,22 @@ PyInit_itz_particle_manager(void)
     if (PyModule_AddIntConstant(module, "EMIT_POINT", _POINT) == -1)
         return NULL;
 
-    init_genrand((uint32_t)time(NULL));
+    if (PyModule_AddIntConstant(module, "FALLOFF_LINEAR", _FALLOFF_LINEAR) == -1 ||
+        PyModule_AddIntConstant(module, "FALLOFF_INVERSE_SQUARE",
+                                _FALLOFF_INVERSE_SQUARE) == -1)
+        return NULL;
+
+    if (PyModule_AddIntConstant(module, "COLLISION_BOUNCE", _COLLISION_BOUNCE) ==
+            -1 ||
+        PyModule_AddIntConstant(module, "COLLISION_KILL", _COLLISION_KILL) == -1)
+        return NULL;
+
+    if (PyModule_AddIntConstant(module, "SIMD_NONE", _SIMD_NONE) == -1 ||
+        PyModule_AddIntConstant(module, "SIMD_SSE2", _SIMD_SSE2) == -1 ||
+        PyModule_AddIntConstant(module, "SIMD_AVX2", _SIMD_AVX2) == -1)
+        return NULL;
+
+    init_curl_noise_lattice();
 
     return module;
 }
@@ -0,0 +1,80 @@
+#include <math.h>
+
+#include "include/noise.h"
+
+#define S NOISE_LATTICE_SIZE
+#define WRAP(i) ((i) & NOISE_LATTICE_MASK)
+#define SMOOTHING_PASSES 3
+
+float curl_noise_x[S * S];
+float curl_noise_y[S * S];
+
+static uint32_t
+lattice_hash(uint32_t x, uint32_t y)
+{
+    /* Fixed integer hash, the lattice must not depend on any RNG state */
+    uint32_t h = x * 0x8da6b343U ^ y * 0xd8163841U;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6dU;
+    h ^= h >> 12;
+    h *= 0x297a2d39U;
+    h ^= h >> 15;
+
+    return h;
+}
+
+void
+init_curl_noise_lattice(void)
+{
+    static float potential[S * S];
+    static float smoothed[S * S];
+
+    /* White noise potential in [-1, 1] */
+    for (int y = 0; y < S; y++)
+        for (int x = 0; x < S; x++)
+            potential[y * S + x] =
+                (float)(lattice_hash(x, y) & 0xFFFF) / 32767.5f - 1.0f;
+
+    /* Repeated 3x3 box blurs with wrap-around, keeps the field tileable */
+    for (int pass = 0; pass < SMOOTHING_PASSES; pass++) {
+        for (int y = 0; y < S; y++) {
+            for (int x = 0; x < S; x++) {
+                float sum = 0.0f;
+                for (int dy = -1; dy <= 1; dy++)
+                    for (int dx = -1; dx <= 1; dx++)
+                        sum += potential[WRAP(y + dy) * S + WRAP(x + dx)];
+                smoothed[y * S + x] = sum / 9.0f;
+            }
+        }
+        memcpy(potential, smoothed, sizeof(potential));
+    }
+
+    /* The curl of a scalar potential is divergence free:
+     * (dP/dy, -dP/dx), approximated with central differences */
+    float max_len = 0.0f;
+    for (int y = 0; y < S; y++) {
+        for (int x = 0; x < S; x++) {
+            const float cx = (potential[WRAP(y + 1) * S + x] -
+                              potential[WRAP(y - 1) * S + x]) *
+                             0.5f;
+            const float cy = -(potential[y * S + WRAP(x + 1)] -
+                               potential[y * S + WRAP(x - 1)]) *
+                             0.5f;
+            curl_noise_x[y * S + x] = cx;
+            curl_noise_y[y * S + x] = cy;
+            max_len = MAX(max_len, sqrtf(cx * cx + cy * cy));
+        }
+    }
+
+    /* Normalize so that noise_strength maps to the peak velocity */
+    if (max_len > 0.0f) {
+        for (int i = 0; i < S * S; i++) {
+            curl_noise_x[i] /= max_len;
+            curl_noise_y[i] /= max_len;
+        }
+    }
+}
+
+#undef S
+#undef WRAP
+#undef SMOOTHING_PASSES
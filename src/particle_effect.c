@@ -3,12 +3,90 @@
 int
 particle_effect_init(ParticleEffectObject *self, PyObject *args, PyObject *kwds)
 {
-    static char *kwlist[] = {"emitters", NULL};
+    static char *kwlist[] = {"emitters", "bounds",       "restitution",
+                             "friction", "on_collision", "seed",
+                             NULL};
     PyObject *emitters = NULL;
+    PyObject *bounds_obj = Py_None;
+    PyObject *seed_obj = Py_None;
+    CollisionBounds *bounds = &self->effect.bounds;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &emitters))
+    bounds->restitution = 0.5f;
+    bounds->friction = 0.0f;
+    bounds->response = _COLLISION_BOUNCE;
+    bounds->in_use = false;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|OffiO", kwlist, &emitters,
+                                     &bounds_obj, &bounds->restitution,
+                                     &bounds->friction, &bounds->response,
+                                     &seed_obj))
         return -1;
 
+    PyMem_Free(self->effect.rng);
+    self->effect.rng = NULL;
+
+    if (seed_obj != Py_None) {
+        uint32_t seed;
+        if (!SeedFromObj(seed_obj, &seed)) {
+            PyErr_SetString(PyExc_TypeError, "Invalid seed, must be an integer");
+            return -1;
+        }
+
+        self->effect.rng = PyMem_New(MTState, 1);
+        if (!self->effect.rng) {
+            PyErr_NoMemory();
+            return -1;
+        }
+
+        init_genrand(self->effect.rng, seed);
+    }
+
+    if (bounds_obj != Py_None) {
+        float x, y, w, h;
+        if (!PySequence_Check(bounds_obj) || PySequence_Length(bounds_obj) != 4 ||
+            !FloatFromObjIndex(bounds_obj, 0, &x) ||
+            !FloatFromObjIndex(bounds_obj, 1, &y) ||
+            !FloatFromObjIndex(bounds_obj, 2, &w) ||
+            !FloatFromObjIndex(bounds_obj, 3, &h)) {
+            PyErr_SetString(PyExc_TypeError,
+                            "Invalid bounds, must be a rect-like (x, y, w, h)");
+            return -1;
+        }
+        if (!(w >= 0.0f) || !(h >= 0.0f)) {
+            PyErr_SetString(PyExc_ValueError,
+                            "Invalid bounds, width and height must be >= 0");
+            return -1;
+        }
+
+        bounds->left = x;
+        bounds->top = y;
+        bounds->right = x + w;
+        bounds->bottom = y + h;
+        bounds->in_use = true;
+    }
+
+    if (!(bounds->restitution >= 0.0f)) {
+        PyErr_SetString(PyExc_ValueError, "Invalid restitution, must be >= 0");
+        return -1;
+    }
+
+    if (!(bounds->friction >= 0.0f && bounds->friction <= 1.0f)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "Invalid friction, must be between 0 and 1");
+        return -1;
+    }
+
+    switch (bounds->response) {
+        case _COLLISION_BOUNCE:
+        case _COLLISION_KILL:
+            break;
+        default:
+            PyErr_SetString(PyExc_ValueError,
+                            "Invalid on_collision, supported values are: "
+                            "COLLISION_BOUNCE and COLLISION_KILL");
+            return -1;
+    }
+
     if (!emitters || !PyTuple_Check(emitters)) {
         PyErr_SetString(PyExc_TypeError, "Invalid emitters, must be a tuple");
         return -1;
@@ -41,6 +119,7 @@ void
 particle_effect_dealloc(ParticleEffectObject *self)
 {
     Py_XDECREF(self->effect.emitters);
+    PyMem_Free(self->effect.rng);
 
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
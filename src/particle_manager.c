@@ -1,8 +1,21 @@
 #include "include/particle_manager.h"
+#include "include/particle_system.h"
 #include "include/pygame.h"
 
 PyObject *
 pm_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"seed", NULL};
+    PyObject *seed_obj = Py_None;
+    uint32_t seed;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &seed_obj))
+        return NULL;
+
+    if (seed_obj == Py_None)
+        seed = genrand_int32(&default_seeds);
+    else if (!SeedFromObj(seed_obj, &seed))
+        return RAISE(PyExc_TypeError, "Invalid seed, must be an integer");
+
     ParticleManager *self = (ParticleManager *) type->tp_alloc(type, 0);
     if (self) {
         self->instances = PyMem_Calloc(PM_BASE_BLOCK_SIZE, sizeof(EffectInstance));
@@ -13,6 +26,33 @@ pm_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
 
         self->allocated_instances = PM_BASE_BLOCK_SIZE;
         self->used_instances = 0;
+
+        self->attractors = NULL;
+        self->allocated_attractors = 0;
+        self->used_attractors = 0;
+        self->max_attractors = PM_DEFAULT_MAX_ATTRACTORS;
+
+        self->grid = NULL;
+
+        init_genrand(&self->rng, seed);
+
+        profiler_reset(&self->prof);
+        self->profiling = false;
+
+        self->tracer = NULL;
+        self->trace_path = NULL;
+
+        self->fixed_dt = 0.0f;
+        self->accumulator = 0.0f;
+        self->updating = false;
+
+        self->max_particles = 0;
+        self->max_draw_ns = 0;
+        self->draw_stride = 1;
+
+        self->scratch = (ScratchArena){0};
+
+        self->system = NULL;
     }
 
     return (PyObject *) self;
@@ -24,6 +64,15 @@ pm_dealloc(ParticleManager *self) {
         dealloc_effect_instance(&self->instances[i]);
 
     PyMem_Free(self->instances);
+    PyMem_Free(self->attractors);
+    _pm_free_grid(self);
+    _pm_free_trace(self);
+    scratch_arena_free(&self->scratch);
+
+    if (self->system) {
+        particle_system_remove_manager(self->system, self);
+        Py_DECREF(self->system);
+    }
 
     Py_TYPE(self)->tp_free((PyObject *) self);
 }
@@ -31,8 +80,8 @@ pm_dealloc(ParticleManager *self) {
 /* =======================| INTERNAL FUNCTIONALITY |======================= */
 
 int
-_pm_spawn_effect_helper(EffectInstance *instance, PyObject *const *args,
-                        Py_ssize_t nargs) {
+_pm_spawn_effect_helper(ParticleManager *self, EffectInstance *instance,
+                        PyObject *const *args, Py_ssize_t nargs) {
     if (!ParticleEffect_Check(args[0])) {
         PyErr_SetString(PyExc_TypeError, "Invalid ParticleEffect object");
         return 0;
@@ -45,7 +94,107 @@ _pm_spawn_effect_helper(EffectInstance *instance, PyObject *const *args,
         return 0;
     }
 
-    return init_effect_instance(instance, &effect->effect, pos);
+    /* Seeded effects draw from their own stream so their particles don't
+     * depend on what else was spawned before them */
+    MTState *rng = effect->effect.rng ? effect->effect.rng : &self->rng;
+
+    const float spawn_scale =
+        self->max_particles ? _pm_spawn_scale(self, &effect->effect) : 1.0f;
+
+    return init_effect_instance(instance, &effect->effect, pos, spawn_scale, rng);
+}
+
+void
+_pm_free_grid(ParticleManager *self) {
+    if (!self->grid)
+        return;
+
+    PyMem_Free(self->grid->cells);
+    PyMem_Free(self->grid);
+    self->grid = NULL;
+}
+
+void
+_pm_free_trace(ParticleManager *self) {
+    tracer_free(self->tracer);
+    self->tracer = NULL;
+    Py_CLEAR(self->trace_path);
+}
+
+int
+_pm_fill_grid_from_mask(OccupancyGrid *grid, PyObject *mask) {
+    /* Registration is a one time cost, so going through the python level
+     * Mask API keeps us independent of pygame's bitmask internals */
+    PyObject *size = PyObject_CallMethod(mask, "get_size", NULL);
+    if (!size)
+        return 0;
+
+    if (!TwoIntsFromObj(size, &grid->width, &grid->height)) {
+        Py_DECREF(size);
+        PyErr_SetString(PyExc_TypeError, "Invalid mask size");
+        return 0;
+    }
+    Py_DECREF(size);
+
+    /* 3 bytes of padding so the SIMD gathers can read 4 bytes at any cell */
+    grid->cells = PyMem_Calloc((size_t)grid->width * grid->height + 3, 1);
+    if (!grid->cells) {
+        PyErr_NoMemory();
+        return 0;
+    }
+
+    for (int y = 0; y < grid->height; y++) {
+        for (int x = 0; x < grid->width; x++) {
+            PyObject *bit = PyObject_CallMethod(mask, "get_at", "((ii))", x, y);
+            if (!bit)
+                return 0;
+
+            int solid = PyObject_IsTrue(bit);
+            Py_DECREF(bit);
+            if (solid == -1)
+                return 0;
+
+            grid->cells[y * grid->width + x] = (uint8_t)solid;
+        }
+    }
+
+    return 1;
+}
+
+int
+_pm_fill_grid_from_buffer(OccupancyGrid *grid, PyObject *obj, int bits) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(obj, &view, PyBUF_SIMPLE) == -1)
+        return 0;
+
+    /* 1-bit rows are packed LSB first and padded to a whole byte */
+    const Py_ssize_t row_bytes = bits == 1 ? (grid->width + 7) / 8 : grid->width;
+    if (view.len < row_bytes * grid->height) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "Buffer is too small for the given size");
+        return 0;
+    }
+
+    grid->cells = PyMem_Calloc((size_t)grid->width * grid->height + 3, 1);
+    if (!grid->cells) {
+        PyBuffer_Release(&view);
+        PyErr_NoMemory();
+        return 0;
+    }
+
+    const uint8_t *src = (const uint8_t *)view.buf;
+
+    for (int y = 0; y < grid->height; y++) {
+        const uint8_t *row = src + y * row_bytes;
+        uint8_t *dst = grid->cells + y * grid->width;
+
+        for (int x = 0; x < grid->width; x++)
+            dst[x] = bits == 1 ? (row[x >> 3] >> (x & 7)) & 1 : row[x] != 0;
+    }
+
+    PyBuffer_Release(&view);
+
+    return 1;
 }
 
 Py_ssize_t
@@ -58,10 +207,146 @@ _pm_get_num_particles(ParticleManager *self) {
     return num_particles;
 }
 
+/* In fixed step mode dt only feeds the accumulator, the simulation then
+ * advances by as many whole substeps as it holds. Returns the number of steps
+ * to run, step_dt receives their size */
+int
+_pm_take_steps(ParticleManager *self, float dt, float *step_dt) {
+    *step_dt = dt;
+
+    if (self->fixed_dt <= 0.0f)
+        return 1;
+
+    self->accumulator += dt;
+    int steps = (int) (self->accumulator / self->fixed_dt);
+
+    /* After a long hitch catching up would only make the next frame
+     * slower, so the backlog past the cap is dropped */
+    if (steps > PM_MAX_SUBSTEPS) {
+        self->accumulator -= (float) (steps - PM_MAX_SUBSTEPS) * self->fixed_dt;
+        steps = PM_MAX_SUBSTEPS;
+    }
+
+    self->accumulator = MAX(self->accumulator - (float) steps * self->fixed_dt, 0.0f);
+    *step_dt = self->fixed_dt;
+
+    return steps;
+}
+
+UpdateContext
+_pm_update_context(ParticleManager *self) {
+    UpdateContext ctx = {
+        .attractors = self->attractors,
+        .attractors_count =
+            (int)MIN(self->used_attractors, (Py_ssize_t)self->max_attractors),
+        .grid = self->grid,
+        .prof = self->profiling ? &self->prof : NULL,
+        .tracer = self->tracer,
+    };
+
+    return ctx;
+}
+
+/* Particles at rest get their velocities once an attractor or a bounce off the
+ * collision map can push them. That allocates, so it's done here with the GIL
+ * held, before the update releases it. Returns 0 with an error set */
+int
+_pm_prepare_update(ParticleManager *self, const UpdateContext *ctx) {
+    if (!ctx->attractors_count &&
+        !(ctx->grid && ctx->grid->response == _COLLISION_BOUNCE))
+        return 1;
+
+    for (Py_ssize_t i = 0; i < self->used_instances; i++) {
+        EffectInstance *effect = &self->instances[i];
+        if (effect->ended)
+            continue;
+
+        for (Py_ssize_t j = 0; j < effect->blocks_count; j++) {
+            DataBlock *block = &effect->p_data[j];
+            if (block->ended || block->velocities_x.data)
+                continue;
+
+            if (!alloc_resting_velocities(block)) {
+                PyErr_NoMemory();
+                return 0;
+            }
+
+            if (self->profiling)
+                self->prof.bytes_allocated +=
+                    2 * block->velocities_x.capacity * (int64_t) sizeof(float);
+        }
+    }
+
+    return 1;
+}
+
+/* Ended effects go through PyMem, they are freed once the GIL is back */
+void
+_pm_remove_ended(ParticleManager *self) {
+    for (Py_ssize_t i = 0; i < self->used_instances; i++) {
+        EffectInstance *effect = &self->instances[i];
+
+        if (effect->ended) {
+            dealloc_effect_instance(effect);
+            memmove(effect, effect + 1,
+                    sizeof(EffectInstance) * (self->used_instances - i - 1));
+            self->used_instances--;
+            i--;
+        }
+    }
+}
+
+/* Fraction of the effect's particles that still fits in the particle budget */
+float
+_pm_spawn_scale(ParticleManager *self, ParticleEffect *effect) {
+    const Py_ssize_t room = self->max_particles - _pm_get_num_particles(self);
+    if (room <= 0)
+        return 0.0f;
+
+    PyObject **emitters = PySequence_Fast_ITEMS(effect->emitters);
+    Py_ssize_t total = 0;
+    for (Py_ssize_t i = 0; i < effect->emitters_count; i++)
+        total += ((EmitterObject *) emitters[i])->emitter.emission_number;
+
+    return total <= room ? 1.0f : (float) room / (float) total;
+}
+
+/* Draws every particle unless a budget is exceeded. Going over the particle
+ * budget thins the draw proportionally, the time budget adds its own stride */
+int
+_pm_draw_stride(ParticleManager *self) {
+    int stride = self->max_draw_ns ? self->draw_stride : 1;
+
+    if (self->max_particles) {
+        const Py_ssize_t live = _pm_get_num_particles(self);
+        const Py_ssize_t over =
+            (live + self->max_particles - 1) / self->max_particles;
+        stride = (int) MAX(stride, MIN(over, PM_MAX_DRAW_STRIDE));
+    }
+
+    return stride;
+}
+
+/* Steps the time based stride towards the draw budget. It is only lowered
+ * when the denser draw is expected to fit too, so it doesn't flip back and
+ * forth on a frame close to the budget */
+void
+_pm_adapt_draw_stride(ParticleManager *self, uint64_t ticks) {
+    const double ns = (double) ticks * 1e9 / (double) SDL_GetPerformanceFrequency();
+    const int stride = self->draw_stride;
+
+    if (ns > (double) self->max_draw_ns && stride < PM_MAX_DRAW_STRIDE)
+        self->draw_stride++;
+    else if (stride > 1 && ns * stride / (stride - 1) < (double) self->max_draw_ns)
+        self->draw_stride--;
+}
+
 /* ======================================================================== */
 
 PyObject *
 pm_spawn_effect(ParticleManager *self, PyObject *const *args, Py_ssize_t nargs) {
+    PM_UPDATING_CHECK(self);
+
     if (nargs != 2) {
         PyErr_Format(PyExc_TypeError,
                      "pm_spawn_effect() requires 2 arguments, %zd given", nargs);
@@ -69,6 +354,10 @@ pm_spawn_effect(ParticleManager *self, PyObject *const *args, Py_ssize_t nargs)
     }
 
     if (self->used_instances + 1 > self->allocated_instances) {
+        if (self->profiling)
+            self->prof.bytes_allocated +=
+                self->allocated_instances * (Py_ssize_t) sizeof(EffectInstance);
+
         self->allocated_instances *= 2;
         self->instances = PyMem_Resize(self->instances, EffectInstance, self->allocated_instances);
         if (!self->instances)
@@ -77,9 +366,13 @@ pm_spawn_effect(ParticleManager *self, PyObject *const *args, Py_ssize_t nargs)
 
     EffectInstance *e_block = &self->instances[self->used_instances];
 
-    if (!_pm_spawn_effect_helper(e_block, args, nargs))
+    if (!_pm_spawn_effect_helper(self, e_block, args, nargs))
         return NULL;
 
+    if (self->profiling)
+        for (Py_ssize_t i = 0; i < e_block->blocks_count; i++)
+            self->prof.bytes_allocated += data_block_allocated_bytes(&e_block->p_data[i]);
+
     self->used_instances++;
 
     Py_RETURN_NONE;
@@ -87,27 +380,51 @@ pm_spawn_effect(ParticleManager *self, PyObject *const *args, Py_ssize_t nargs)
 
 PyObject *
 pm_update(ParticleManager *self, PyObject *arg) {
+    PM_UPDATING_CHECK(self);
+
     float dt;
     if (!FloatFromObj(arg, &dt))
         return RAISE(PyExc_TypeError, "Invalid dt parameter, must be numeric");
 
-    for (Py_ssize_t i = 0; i < self->used_instances; i++) {
-        EffectInstance *effect = &self->instances[i];
-        update_effect_instance(effect, dt);
-        if (effect->ended) {
-            dealloc_effect_instance(effect);
-            memmove(effect, effect + 1,
-                    sizeof(EffectInstance) * (self->used_instances - i - 1));
-            self->used_instances--;
-            i--;
+    /* Prepared before taking the steps, so a failed call keeps its dt */
+    const UpdateContext ctx = _pm_update_context(self);
+    if (!_pm_prepare_update(self, &ctx))
+        return NULL;
+
+    const int steps = _pm_take_steps(self, dt, &dt);
+
+    trace_begin(self->tracer, "pm_update", -1);
+
+    /* Updating only touches particle data, so all the substeps run in one go
+     * without the GIL */
+    self->updating = true;
+    Py_BEGIN_ALLOW_THREADS
+
+    for (int step = 0; step < steps; step++) {
+        for (Py_ssize_t i = 0; i < self->used_instances; i++) {
+            EffectInstance *effect = &self->instances[i];
+            if (effect->ended)
+                continue;
+
+            trace_begin(self->tracer, "update_effect_instance", (int) i);
+            update_effect_instance(effect, dt, &ctx);
+            trace_end(self->tracer, "update_effect_instance");
         }
     }
 
+    Py_END_ALLOW_THREADS
+    self->updating = false;
+
+    _pm_remove_ended(self);
+
+    trace_end(self->tracer, "pm_update");
+
     Py_RETURN_NONE;
 }
 
-PyObject *
-pm_draw(ParticleManager *self, PyObject *arg) {
+/* Returns the surface to draw on, or NULL with an error set */
+pgSurfaceObject *
+_pm_draw_target(PyObject *arg) {
     if (!pgSurface_Check(arg))
         return RAISE(PyExc_TypeError, "Invalid surface object");
 
@@ -119,9 +436,311 @@ pm_draw(ParticleManager *self, PyObject *arg) {
         return NULL;
     }
 
-    for (Py_ssize_t i = 0; i < self->used_instances; i++)
-        if (!draw_effect_instance(&self->instances[i], dest))
+    return dest;
+}
+
+DrawContext
+_pm_draw_context(ParticleManager *self) {
+    /* In fixed step mode the leftover time is drawn ahead, so motion stays
+     * smooth when frames and substeps don't line up */
+    DrawContext ctx = {
+        .prof = self->profiling ? &self->prof : NULL,
+        .tracer = self->tracer,
+        .lead_time = self->fixed_dt > 0.0f ? self->accumulator : 0.0f,
+        .stride = _pm_draw_stride(self),
+        .scratch = &self->scratch,
+    };
+
+    return ctx;
+}
+
+PyObject *
+pm_draw(ParticleManager *self, PyObject *arg) {
+    PM_UPDATING_CHECK(self);
+
+    pgSurfaceObject *dest = _pm_draw_target(arg);
+    if (!dest)
+        return NULL;
+
+    const DrawContext ctx = _pm_draw_context(self);
+
+    const uint64_t start = SDL_GetPerformanceCounter();
+
+    trace_begin(self->tracer, "pm_draw", -1);
+
+    for (Py_ssize_t i = 0; i < self->used_instances; i++) {
+        if (!draw_effect_instance(&self->instances[i], dest, &ctx)) {
+            trace_end(self->tracer, "pm_draw");
+            return NULL;
+        }
+    }
+
+    trace_end(self->tracer, "pm_draw");
+
+    if (self->max_draw_ns)
+        _pm_adapt_draw_stride(self, SDL_GetPerformanceCounter() - start);
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pm_update_and_draw(ParticleManager *self, PyObject *const *args, Py_ssize_t nargs) {
+    PM_UPDATING_CHECK(self);
+
+    if (nargs != 2) {
+        PyErr_Format(PyExc_TypeError,
+                     "update_and_draw() requires 2 arguments, %zd given", nargs);
+        return NULL;
+    }
+
+    float dt;
+    if (!FloatFromObj(args[0], &dt))
+        return RAISE(PyExc_TypeError, "Invalid dt parameter, must be numeric");
+
+    pgSurfaceObject *dest = _pm_draw_target(args[1]);
+    if (!dest)
+        return NULL;
+
+    const UpdateContext update_ctx = _pm_update_context(self);
+    if (!_pm_prepare_update(self, &update_ctx))
+        return NULL;
+
+    const int steps = _pm_take_steps(self, dt, &dt);
+    const DrawContext draw_ctx = _pm_draw_context(self);
+
+    /* Blitting needs the GIL, so unlike update() it's held throughout. Only
+     * the draws are timed, the draw budget shouldn't pay for the updates */
+    uint64_t draw_ticks = 0;
+
+    trace_begin(self->tracer, "pm_update_and_draw", -1);
+
+    for (Py_ssize_t i = 0; i < self->used_instances; i++) {
+        EffectInstance *effect = &self->instances[i];
+        if (effect->ended)
+            continue;
+
+        if (!update_and_draw_effect_instance(effect, dt, steps, &update_ctx, dest,
+                                             &draw_ctx, &draw_ticks)) {
+            trace_end(self->tracer, "pm_update_and_draw");
             return NULL;
+        }
+    }
+
+    _pm_remove_ended(self);
+
+    trace_end(self->tracer, "pm_update_and_draw");
+
+    if (self->max_draw_ns)
+        _pm_adapt_draw_stride(self, draw_ticks);
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pm_add_attractor(ParticleManager *self, PyObject *args, PyObject *kwds) {
+    PM_UPDATING_CHECK(self);
+
+    static char *kwlist[] = {"pos", "strength", "radius", "falloff", NULL};
+    PyObject *pos_obj;
+    Attractor attractor = {.falloff = _FALLOFF_INVERSE_SQUARE};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "Off|i", kwlist, &pos_obj,
+                                     &attractor.strength, &attractor.radius,
+                                     &attractor.falloff))
+        return NULL;
+
+    if (!TwoFloatsFromObj(pos_obj, &attractor.position.x, &attractor.position.y))
+        return RAISE(PyExc_TypeError, "Invalid position argument");
+
+    if (attractor.radius <= 0.0f)
+        return RAISE(PyExc_ValueError, "radius must be positive");
+
+    switch (attractor.falloff) {
+        case _FALLOFF_LINEAR:
+        case _FALLOFF_INVERSE_SQUARE:
+            break;
+        default:
+            return RAISE(PyExc_ValueError,
+                         "Invalid falloff, supported falloffs are: "
+                         "FALLOFF_LINEAR and FALLOFF_INVERSE_SQUARE");
+    }
+
+    if (self->used_attractors + 1 > self->allocated_attractors) {
+        Py_ssize_t new_size = MAX(self->allocated_attractors * 2, PM_BASE_BLOCK_SIZE);
+        Attractor *attractors = PyMem_Resize(self->attractors, Attractor, new_size);
+        if (!attractors)
+            return PyErr_NoMemory();
+
+        self->attractors = attractors;
+        self->allocated_attractors = new_size;
+    }
+
+    self->attractors[self->used_attractors++] = attractor;
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pm_clear_attractors(ParticleManager *self, PyObject *_null) {
+    PM_UPDATING_CHECK(self);
+
+    self->used_attractors = 0;
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pm_set_collision_map(ParticleManager *self, PyObject *args, PyObject *kwds) {
+    PM_UPDATING_CHECK(self);
+
+    static char *kwlist[] = {"grid",         "cell_size",   "size", "bits",
+                             "on_collision", "restitution", NULL};
+    PyObject *grid_obj, *size_obj = Py_None;
+    float cell_size = 1.0f;
+    int bits = 8;
+    OccupancyGrid grid = {.restitution = 0.5f, .response = _COLLISION_BOUNCE};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|fOiif", kwlist, &grid_obj,
+                                     &cell_size, &size_obj, &bits, &grid.response,
+                                     &grid.restitution))
+        return NULL;
+
+    if (cell_size <= 0.0f)
+        return RAISE(PyExc_ValueError, "cell_size must be positive");
+
+    switch (grid.response) {
+        case _COLLISION_BOUNCE:
+        case _COLLISION_KILL:
+            break;
+        default:
+            return RAISE(PyExc_ValueError,
+                         "Invalid on_collision, supported values are: "
+                         "COLLISION_BOUNCE and COLLISION_KILL");
+    }
+
+    grid.inv_cell_size = 1.0f / cell_size;
+
+    if (PyObject_HasAttrString(grid_obj, "get_at") &&
+        PyObject_HasAttrString(grid_obj, "get_size")) {
+        if (!_pm_fill_grid_from_mask(&grid, grid_obj)) {
+            PyMem_Free(grid.cells);
+            return NULL;
+        }
+    }
+    else if (PyObject_CheckBuffer(grid_obj)) {
+        if (size_obj == Py_None ||
+            !TwoIntsFromObj(size_obj, &grid.width, &grid.height) ||
+            grid.width <= 0 || grid.height <= 0)
+            return RAISE(PyExc_ValueError,
+                         "A positive size is required for buffer collision maps");
+
+        if (bits != 1 && bits != 8)
+            return RAISE(PyExc_ValueError, "bits must be 1 or 8");
+
+        if (!_pm_fill_grid_from_buffer(&grid, grid_obj, bits)) {
+            PyMem_Free(grid.cells);
+            return NULL;
+        }
+    }
+    else {
+        return RAISE(PyExc_TypeError,
+                     "Invalid collision map, must be a pygame.mask.Mask or an "
+                     "object supporting the buffer protocol");
+    }
+
+    _pm_free_grid(self);
+
+    self->grid = PyMem_New(OccupancyGrid, 1);
+    if (!self->grid) {
+        PyMem_Free(grid.cells);
+        return PyErr_NoMemory();
+    }
+
+    *self->grid = grid;
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pm_clear_collision_map(ParticleManager *self, PyObject *_null) {
+    PM_UPDATING_CHECK(self);
+
+    _pm_free_grid(self);
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pm_set_budget(ParticleManager *self, PyObject *args, PyObject *kwds) {
+    PM_UPDATING_CHECK(self);
+
+    static char *kwlist[] = {"max_particles", "max_draw_ns", NULL};
+    Py_ssize_t max_particles = 0;
+    long long max_draw_ns = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|nL", kwlist, &max_particles,
+                                     &max_draw_ns))
+        return NULL;
+
+    if (max_particles < 0 || max_draw_ns < 0)
+        return RAISE(PyExc_ValueError,
+                     "Budgets must be non-negative, 0 disables them");
+
+    self->max_particles = max_particles;
+    self->max_draw_ns = max_draw_ns;
+    self->draw_stride = 1;
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pm_stats(ParticleManager *self, PyObject *_null) {
+    PM_UPDATING_CHECK(self);
+
+    PyObject *stats = profiler_as_dict(&self->prof);
+    if (!stats)
+        return NULL;
+
+    profiler_reset(&self->prof);
+
+    return stats;
+}
+
+PyObject *
+pm_start_trace(ParticleManager *self, PyObject *arg) {
+    PM_UPDATING_CHECK(self);
+
+    if (self->tracer)
+        return RAISE(PyExc_RuntimeError, "A trace is already running");
+
+    PyObject *path;
+    if (!PyUnicode_FSConverter(arg, &path))
+        return NULL;
+
+    self->tracer = tracer_new();
+    if (!self->tracer) {
+        Py_DECREF(path);
+        return NULL;
+    }
+
+    self->trace_path = path;
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pm_stop_trace(ParticleManager *self, PyObject *_null) {
+    PM_UPDATING_CHECK(self);
+
+    if (!self->tracer)
+        return RAISE(PyExc_RuntimeError, "No trace is running");
+
+    int ok = tracer_dump(self->tracer, PyBytes_AS_STRING(self->trace_path));
+
+    _pm_free_trace(self);
+
+    if (!ok)
+        return NULL;
 
     Py_RETURN_NONE;
 }
@@ -138,4 +757,80 @@ pm_get_num_particles(ParticleManager *self, void *closure) {
     return PyLong_FromSsize_t(_pm_get_num_particles(self));
 }
 
+PyObject *
+pm_get_max_attractors(ParticleManager *self, void *closure) {
+    return PyLong_FromLong(self->max_attractors);
+}
+
+int
+pm_set_max_attractors(ParticleManager *self, PyObject *value, void *closure) {
+    if (self->updating) {
+        PyErr_SetString(PyExc_RuntimeError, "The ParticleManager is being updated");
+        return -1;
+    }
+
+    int max_attractors;
+    if (!value || !IntFromObj(value, &max_attractors) || max_attractors < 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "max_attractors must be a non-negative integer");
+        return -1;
+    }
+
+    self->max_attractors = max_attractors;
+
+    return 0;
+}
+
+PyObject *
+pm_get_fixed_timestep(ParticleManager *self, void *closure) {
+    return PyFloat_FromDouble(self->fixed_dt);
+}
+
+int
+pm_set_fixed_timestep(ParticleManager *self, PyObject *value, void *closure) {
+    if (self->updating) {
+        PyErr_SetString(PyExc_RuntimeError, "The ParticleManager is being updated");
+        return -1;
+    }
+
+    float fixed_dt;
+    if (!value || !FloatFromObj(value, &fixed_dt) || fixed_dt < 0.0f) {
+        PyErr_SetString(PyExc_ValueError,
+                        "fixed_timestep must be a non-negative number");
+        return -1;
+    }
+
+    self->fixed_dt = fixed_dt;
+    self->accumulator = 0.0f;
+
+    return 0;
+}
+
+PyObject *
+pm_get_profiling(ParticleManager *self, void *closure) {
+    return PyBool_FromLong(self->profiling);
+}
+
+int
+pm_set_profiling(ParticleManager *self, PyObject *value, void *closure) {
+    if (self->updating) {
+        PyErr_SetString(PyExc_RuntimeError, "The ParticleManager is being updated");
+        return -1;
+    }
+
+    int profiling;
+    if (!value || (profiling = PyObject_IsTrue(value)) == -1) {
+        PyErr_SetString(PyExc_TypeError, "Invalid profiling value");
+        return -1;
+    }
+
+    /* Don't carry stale counters over a disabled period */
+    if (profiling && !self->profiling)
+        profiler_reset(&self->prof);
+
+    self->profiling = profiling;
+
+    return 0;
+}
+
 /* ===================================================================== */
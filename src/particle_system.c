@@ -0,0 +1,276 @@
+#include "include/particle_system.h"
+
+/* One running effect of one manager, the unit a worker claims */
+typedef struct {
+    EffectInstance *instance;
+    const UpdateContext *ctx; /* the owning manager's */
+    int index;                /* instance index, for the trace */
+    int steps;
+    float dt;
+    Py_ssize_t cost; /* particles times steps, biggest jobs go first */
+} UpdateJob;
+
+typedef struct {
+    UpdateJob *jobs;
+    SDL_mutex *merge_lock;
+} UpdateBatch;
+
+PyObject *
+ps_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"workers", "seed", NULL};
+    PyObject *workers_obj = Py_None, *seed_obj = Py_None;
+    uint32_t seed;
+
+    /* The calling thread takes jobs too, so one core is left to it. Bigger
+     * machines get the most the pool supports rather than an error */
+    int workers = MIN(MAX(SDL_GetCPUCount() - 1, 0), PS_MAX_WORKERS);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OO", kwlist, &workers_obj,
+                                     &seed_obj))
+        return NULL;
+
+    if (workers_obj != Py_None && !IntFromObj(workers_obj, &workers))
+        return RAISE(PyExc_TypeError, "Invalid workers, must be an integer");
+
+    if (workers < 0 || workers > PS_MAX_WORKERS)
+        return PyErr_Format(PyExc_ValueError,
+                            "Invalid workers, must be between 0 and %d",
+                            PS_MAX_WORKERS);
+
+    if (seed_obj == Py_None)
+        seed = genrand_int32(&default_seeds);
+    else if (!SeedFromObj(seed_obj, &seed))
+        return RAISE(PyExc_TypeError, "Invalid seed, must be an integer");
+
+    ParticleSystem *self = (ParticleSystem *)type->tp_alloc(type, 0);
+    if (!self)
+        return NULL;
+
+    /* tp_alloc zeroes the object, so dealloc is safe from here on */
+    self->merge_lock = SDL_CreateMutex();
+    if (!self->merge_lock) {
+        PyErr_Format(PyExc_RuntimeError, "Could not create a mutex: %s",
+                     SDL_GetError());
+        Py_DECREF(self);
+        return NULL;
+    }
+
+    if (!worker_pool_init(&self->pool, workers)) {
+        Py_DECREF(self);
+        return NULL;
+    }
+
+    init_genrand(&self->rng, seed);
+
+    self->managers = NULL;
+    self->used_managers = 0;
+    self->allocated_managers = 0;
+    self->updating = false;
+
+    return (PyObject *)self;
+}
+
+void
+ps_dealloc(ParticleSystem *self)
+{
+    /* Every manager holds a reference, so none is left by now */
+    worker_pool_free(&self->pool);
+
+    if (self->merge_lock)
+        SDL_DestroyMutex(self->merge_lock);
+
+    PyMem_Free(self->managers);
+
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+void
+particle_system_remove_manager(ParticleSystem *self, ParticleManager *manager)
+{
+    for (Py_ssize_t i = 0; i < self->used_managers; i++) {
+        if (self->managers[i] != manager)
+            continue;
+
+        memmove(self->managers + i, self->managers + i + 1,
+                sizeof(ParticleManager *) * (self->used_managers - i - 1));
+        self->used_managers--;
+        return;
+    }
+}
+
+static int
+compare_jobs(const void *a, const void *b)
+{
+    const Py_ssize_t ca = ((const UpdateJob *)a)->cost;
+    const Py_ssize_t cb = ((const UpdateJob *)b)->cost;
+
+    return (ca < cb) - (ca > cb);
+}
+
+static void
+run_update_job(void *arg, int index)
+{
+    const UpdateBatch *batch = arg;
+    const UpdateJob *job = &batch->jobs[index];
+    UpdateContext ctx = *job->ctx;
+    Profiler prof;
+
+    /* Counters go to a local profiler first, so workers updating effects of
+     * the same manager never write to the same one */
+    if (ctx.prof) {
+        profiler_reset(&prof);
+        ctx.prof = &prof;
+    }
+
+    trace_begin(ctx.tracer, "update_effect_instance", job->index);
+    for (int step = 0; step < job->steps; step++)
+        update_effect_instance(job->instance, job->dt, &ctx);
+    trace_end(ctx.tracer, "update_effect_instance");
+
+    if (ctx.prof) {
+        SDL_LockMutex(batch->merge_lock);
+        profiler_merge(job->ctx->prof, &prof);
+        SDL_UnlockMutex(batch->merge_lock);
+    }
+}
+
+PyObject *
+ps_create_manager(ParticleSystem *self, PyObject *_null)
+{
+    if (self->updating)
+        return RAISE(PyExc_RuntimeError, "The ParticleSystem is being updated");
+
+    if (self->used_managers == self->allocated_managers) {
+        Py_ssize_t new_size = MAX(self->allocated_managers * 2, PM_BASE_BLOCK_SIZE);
+        ParticleManager **managers = self->managers;
+
+        PyMem_Resize(managers, ParticleManager *, new_size);
+        if (!managers)
+            return PyErr_NoMemory();
+
+        self->managers = managers;
+        self->allocated_managers = new_size;
+    }
+
+    /* Every layer gets its own stream, derived from the system's seed */
+    ParticleManager *manager = (ParticleManager *)PyObject_CallFunction(
+        (PyObject *)&ParticleManagerType, "k",
+        (unsigned long)genrand_int32(&self->rng));
+    if (!manager)
+        return NULL;
+
+    manager->system = self;
+    Py_INCREF(self);
+
+    self->managers[self->used_managers++] = manager;
+
+    return (PyObject *)manager;
+}
+
+PyObject *
+ps_update(ParticleSystem *self, PyObject *arg)
+{
+    if (self->updating)
+        return RAISE(PyExc_RuntimeError, "The ParticleSystem is being updated");
+
+    float dt;
+    if (!FloatFromObj(arg, &dt))
+        return RAISE(PyExc_TypeError, "Invalid dt parameter, must be numeric");
+
+    Py_ssize_t max_jobs = 0;
+    for (Py_ssize_t m = 0; m < self->used_managers; m++) {
+        ParticleManager *manager = self->managers[m];
+        if (manager->updating)
+            return RAISE(PyExc_RuntimeError,
+                         "The ParticleManager is being updated");
+
+        const UpdateContext ctx = _pm_update_context(manager);
+        if (!_pm_prepare_update(manager, &ctx))
+            return NULL;
+
+        max_jobs += manager->used_instances;
+    }
+
+    if (max_jobs > INT_MAX)
+        return RAISE(PyExc_OverflowError, "Too many effects to update");
+
+    UpdateContext *contexts = PyMem_New(UpdateContext, self->used_managers + 1);
+    UpdateJob *jobs = PyMem_New(UpdateJob, max_jobs + 1);
+    if (!contexts || !jobs) {
+        PyMem_Free(contexts);
+        PyMem_Free(jobs);
+        return PyErr_NoMemory();
+    }
+
+    /* Managers only keep the system alive, not the other way around. Each one
+     * is held for the batch so python code can't free it in between */
+    int num_jobs = 0;
+    for (Py_ssize_t m = 0; m < self->used_managers; m++) {
+        ParticleManager *manager = self->managers[m];
+        float step_dt;
+        const int steps = _pm_take_steps(manager, dt, &step_dt);
+
+        contexts[m] = _pm_update_context(manager);
+
+        for (Py_ssize_t i = 0; i < manager->used_instances && steps; i++) {
+            EffectInstance *instance = &manager->instances[i];
+            if (instance->ended)
+                continue;
+
+            UpdateJob *job = &jobs[num_jobs++];
+            job->instance = instance;
+            job->ctx = &contexts[m];
+            job->index = (int)i;
+            job->steps = steps;
+            job->dt = step_dt;
+            job->cost = 0;
+
+            for (Py_ssize_t j = 0; j < instance->blocks_count; j++)
+                job->cost += instance->p_data[j].particles_count;
+            job->cost *= steps;
+        }
+
+        Py_INCREF(manager);
+        manager->updating = true;
+    }
+
+    qsort(jobs, num_jobs, sizeof(UpdateJob), compare_jobs);
+
+    UpdateBatch batch = {.jobs = jobs, .merge_lock = self->merge_lock};
+
+    self->updating = true;
+    Py_BEGIN_ALLOW_THREADS
+
+    worker_pool_run(&self->pool, run_update_job, &batch, num_jobs);
+
+    Py_END_ALLOW_THREADS
+    self->updating = false;
+
+    /* Walked backwards as releasing a manager may remove it from the array */
+    for (Py_ssize_t m = self->used_managers - 1; m >= 0; m--) {
+        ParticleManager *manager = self->managers[m];
+
+        manager->updating = false;
+        _pm_remove_ended(manager);
+        Py_DECREF(manager);
+    }
+
+    PyMem_Free(contexts);
+    PyMem_Free(jobs);
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+ps_str(ParticleSystem *self)
+{
+    return PyUnicode_FromFormat("ParticleSystem(workers: %d, managers: %zd)",
+                                self->pool.num_threads, self->used_managers);
+}
+
+PyObject *
+ps_get_workers(ParticleSystem *self, void *closure)
+{
+    return PyLong_FromLong(self->pool.num_threads);
+}
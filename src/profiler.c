@@ -0,0 +1,68 @@
+#include "include/profiler.h"
+
+static const char *const phase_names[_PHASE_COUNT] = {
+    "forces_ns",      "update_ns",       "collisions_ns", "particle_count_ns",
+    "occurrences_ns", "destinations_ns", "blit_ns",
+};
+
+void
+profiler_reset(Profiler *prof)
+{
+    memset(prof, 0, sizeof(Profiler));
+}
+
+void
+profiler_merge(Profiler *dst, const Profiler *src)
+{
+    for (int i = 0; i < _PHASE_COUNT; i++)
+        dst->ticks[i] += src->ticks[i];
+
+    dst->particles_updated += src->particles_updated;
+    dst->particles_culled += src->particles_culled;
+    dst->particles_decimated += src->particles_decimated;
+    dst->destinations += src->destinations;
+    dst->pixels_blended += src->pixels_blended;
+    dst->bytes_allocated += src->bytes_allocated;
+}
+
+static int
+set_int_item(PyObject *dict, const char *key, long long value)
+{
+    PyObject *item = PyLong_FromLongLong(value);
+    if (!item)
+        return 0;
+
+    int res = PyDict_SetItemString(dict, key, item);
+    Py_DECREF(item);
+
+    return res == 0;
+}
+
+PyObject *
+profiler_as_dict(const Profiler *prof)
+{
+    PyObject *dict = PyDict_New();
+    if (!dict)
+        return NULL;
+
+    const double ns_per_tick = 1e9 / (double)SDL_GetPerformanceFrequency();
+
+    for (int i = 0; i < _PHASE_COUNT; i++)
+        if (!set_int_item(dict, phase_names[i],
+                          (long long)(prof->ticks[i] * ns_per_tick)))
+            goto on_error;
+
+    if (!set_int_item(dict, "particles_updated", prof->particles_updated) ||
+        !set_int_item(dict, "particles_culled", prof->particles_culled) ||
+        !set_int_item(dict, "particles_decimated", prof->particles_decimated) ||
+        !set_int_item(dict, "destinations", prof->destinations) ||
+        !set_int_item(dict, "pixels_blended", prof->pixels_blended) ||
+        !set_int_item(dict, "bytes_allocated", prof->bytes_allocated))
+        goto on_error;
+
+    return dict;
+
+on_error:
+    Py_DECREF(dict);
+    return NULL;
+}
@@ -0,0 +1,43 @@
+#include "include/scratch_arena.h"
+
+int
+scratch_arena_reset(ScratchArena *arena, size_t size)
+{
+    arena->used = 0;
+
+    if (size <= arena->capacity)
+        return 1;
+
+    /* Nothing in it is alive anymore, so there's nothing to copy over */
+    const size_t capacity = Py_MAX(size, arena->capacity + arena->capacity / 2);
+
+    PyMem_Free(arena->data);
+    arena->data = PyMem_Malloc(capacity);
+    if (!arena->data) {
+        arena->capacity = 0;
+        PyErr_NoMemory();
+        return 0;
+    }
+
+    arena->capacity = capacity;
+
+    return 1;
+}
+
+void *
+scratch_arena_alloc(ScratchArena *arena, size_t size)
+{
+    void *ptr = arena->data + arena->used;
+    arena->used += SCRATCH_ROUND(size);
+
+    return ptr;
+}
+
+void
+scratch_arena_free(ScratchArena *arena)
+{
+    PyMem_Free(arena->data);
+    arena->data = NULL;
+    arena->used = 0;
+    arena->capacity = 0;
+}
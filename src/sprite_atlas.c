@@ -0,0 +1,453 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "include/sprite_atlas.h"
+
+/* Live atlases, chained by hash. Only touched with the GIL held */
+static SpriteAtlas *atlas_cache[ATLAS_CACHE_BUCKETS];
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static FORCEINLINE uint64_t
+hash_word(uint64_t h, uint32_t word)
+{
+    return (h ^ word) * FNV_PRIME;
+}
+
+/* FNV-1a over the frame sizes, the pixel format and the visible pixels, one
+ * 32-bit word at a time. Surface padding is left out so that frames with the
+ * same pixels hash the same whatever their pitch */
+static uint64_t
+hash_frames(PyObject *const *frames, int num_frames)
+{
+    uint64_t h = FNV_OFFSET;
+
+    h = hash_word(h, ((pgSurfaceObject *)frames[0])->surf->format->format);
+
+    for (int i = 0; i < num_frames; i++) {
+        SDL_Surface *surf = ((pgSurfaceObject *)frames[i])->surf;
+        const uint8_t *row = (const uint8_t *)surf->pixels;
+
+        h = hash_word(h, (uint32_t)surf->w);
+        h = hash_word(h, (uint32_t)surf->h);
+
+        for (int y = 0; y < surf->h; y++) {
+            const uint32_t *px = (const uint32_t *)row;
+            for (int x = 0; x < surf->w; x++)
+                h = hash_word(h, px[x]);
+            row += surf->pitch;
+        }
+    }
+
+    return h;
+}
+
+/* The hash only narrows the search down, a hit is confirmed pixel by pixel */
+static bool
+atlas_matches(const SpriteAtlas *atlas, uint64_t hash, PyObject *const *frames,
+              int num_frames)
+{
+    if (atlas->hash != hash || atlas->num_frames != num_frames ||
+        atlas->format != ((pgSurfaceObject *)frames[0])->surf->format->format)
+        return false;
+
+    for (int i = 0; i < num_frames; i++) {
+        SDL_Surface *surf = ((pgSurfaceObject *)frames[i])->surf;
+        const AtlasFrame *frame = &atlas->frames[i];
+
+        if (frame->width != surf->w || frame->height != surf->h)
+            return false;
+
+        const uint32_t *packed = atlas->pixels + frame->offset;
+        const uint8_t *row = (const uint8_t *)surf->pixels;
+
+        for (int y = 0; y < surf->h; y++) {
+            if (memcmp(packed, row, surf->w * sizeof(uint32_t)) != 0)
+                return false;
+            packed += atlas->pitch;
+            row += surf->pitch;
+        }
+    }
+
+    return true;
+}
+
+/* Zeroed, ATLAS_ALIGN aligned storage for rows rows of pitch pixels. Padding
+ * pixels are zeroed so that reading a whole vector past the end of a row is
+ * harmless, even for the additive blend. memory receives what to free */
+static uint32_t *
+alloc_pixels(int pitch, int rows, void **memory)
+{
+    const size_t size = (size_t)pitch * MAX(rows, 1) * sizeof(uint32_t);
+    *memory = PyMem_Calloc(1, size + ATLAS_ALIGN - 1);
+    if (!*memory) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    return (uint32_t *)(((uintptr_t)*memory + ATLAS_ALIGN - 1) &
+                        ~(uintptr_t)(ATLAS_ALIGN - 1));
+}
+
+/* Room for num_frames with no pixel storage yet */
+static SpriteAtlas *
+alloc_atlas_frames(int pitch, int num_frames)
+{
+    SpriteAtlas *atlas = PyMem_Malloc(sizeof(SpriteAtlas) +
+                                      num_frames * sizeof(AtlasFrame));
+    if (!atlas) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    atlas->pixels = NULL;
+    atlas->memory = NULL;
+    atlas->pitch = pitch;
+    atlas->num_frames = num_frames;
+    atlas->refcount = 1;
+    atlas->hash = 0;
+    atlas->next = NULL;
+
+    return atlas;
+}
+
+/* Zeroed storage for rows rows of pitch pixels, with room for num_frames */
+static SpriteAtlas *
+alloc_atlas(int pitch, int rows, int num_frames)
+{
+    SpriteAtlas *atlas = alloc_atlas_frames(pitch, num_frames);
+    if (!atlas)
+        return NULL;
+
+    atlas->pixels = alloc_pixels(pitch, rows, &atlas->memory);
+    if (!atlas->pixels) {
+        PyMem_Free(atlas);
+        return NULL;
+    }
+
+    return atlas;
+}
+
+static void
+free_atlas(SpriteAtlas *atlas)
+{
+    PyMem_Free(atlas->memory);
+    PyMem_Free(atlas);
+}
+
+/* Black pixels are left out, they don't show with the additive blend. The
+ * result keeps the atlas' channel layout with the remaining byte zeroed */
+static uint32_t
+average_color(const SpriteAtlas *atlas, const AtlasFrame *frame)
+{
+    const uint8_t *row = (const uint8_t *)(atlas->pixels + frame->offset);
+    uint64_t r = 0, g = 0, b = 0, lit = 0;
+
+    for (int y = 0; y < frame->height; y++) {
+        for (int x = 0; x < frame->width; x++) {
+            const uint8_t *px = row + 4 * x;
+            if (!px[atlas->Ridx] && !px[atlas->Gidx] && !px[atlas->Bidx])
+                continue;
+
+            r += px[atlas->Ridx];
+            g += px[atlas->Gidx];
+            b += px[atlas->Bidx];
+            lit++;
+        }
+        row += 4 * atlas->pitch;
+    }
+
+    if (!lit)
+        return 0;
+
+    uint32_t color = 0;
+    uint8_t *out = (uint8_t *)&color;
+    out[atlas->Ridx] = (uint8_t)((r + lit / 2) / lit);
+    out[atlas->Gidx] = (uint8_t)((g + lit / 2) / lit);
+    out[atlas->Bidx] = (uint8_t)((b + lit / 2) / lit);
+
+    return color;
+}
+
+static SpriteAtlas *
+pack_frames(PyObject *const *frames, int num_frames)
+{
+    int max_w = 0, total_h = 0;
+
+    for (int i = 0; i < num_frames; i++) {
+        SDL_Surface *surf = ((pgSurfaceObject *)frames[i])->surf;
+        max_w = MAX(max_w, surf->w);
+        total_h += surf->h;
+    }
+
+    const int pitch = (max_w + ATLAS_ROW_ALIGN - 1) & ~(ATLAS_ROW_ALIGN - 1);
+
+    SpriteAtlas *atlas = alloc_atlas(pitch, total_h, num_frames);
+    if (!atlas)
+        return NULL;
+
+    SDL_PixelFormat *fmt = ((pgSurfaceObject *)frames[0])->surf->format;
+    atlas->format = fmt->format;
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    atlas->Ridx = fmt->Rshift >> 3;
+    atlas->Gidx = fmt->Gshift >> 3;
+    atlas->Bidx = fmt->Bshift >> 3;
+#else
+    atlas->Ridx = 3 - (fmt->Rshift >> 3);
+    atlas->Gidx = 3 - (fmt->Gshift >> 3);
+    atlas->Bidx = 3 - (fmt->Bshift >> 3);
+#endif
+
+    int row = 0;
+    for (int i = 0; i < num_frames; i++) {
+        SDL_Surface *surf = ((pgSurfaceObject *)frames[i])->surf;
+        AtlasFrame *frame = &atlas->frames[i];
+
+        frame->offset = row * pitch;
+        frame->width = surf->w;
+        frame->height = surf->h;
+
+        uint32_t *dst = atlas->pixels + frame->offset;
+        const uint8_t *src = (const uint8_t *)surf->pixels;
+
+        for (int y = 0; y < surf->h; y++) {
+            memcpy(dst, src, surf->w * sizeof(uint32_t));
+            dst += pitch;
+            src += surf->pitch;
+        }
+
+        frame->average = average_color(atlas, frame);
+        row += surf->h;
+    }
+
+    return atlas;
+}
+
+SpriteAtlas *
+sprite_atlas_from_frames(PyObject *const *frames, int num_frames)
+{
+    const uint64_t hash = hash_frames(frames, num_frames);
+    SpriteAtlas **bucket = &atlas_cache[hash % ATLAS_CACHE_BUCKETS];
+
+    for (SpriteAtlas *atlas = *bucket; atlas; atlas = atlas->next) {
+        if (atlas_matches(atlas, hash, frames, num_frames)) {
+            sprite_atlas_incref(atlas);
+            return atlas;
+        }
+    }
+
+    SpriteAtlas *atlas = pack_frames(frames, num_frames);
+    if (!atlas)
+        return NULL;
+
+    atlas->hash = hash;
+    atlas->next = *bucket;
+    *bucket = atlas;
+
+    return atlas;
+}
+
+void
+sprite_atlas_incref(SpriteAtlas *atlas)
+{
+    atlas->refcount++;
+}
+
+void
+sprite_atlas_decref(SpriteAtlas *atlas)
+{
+    if (!atlas || --atlas->refcount > 0)
+        return;
+
+    SpriteAtlas **link = &atlas_cache[atlas->hash % ATLAS_CACHE_BUCKETS];
+    while (*link != atlas)
+        link = &(*link)->next;
+    *link = atlas->next;
+
+    free_atlas(atlas);
+}
+
+/* Frame, scale and rotation of a slot, as cosine and sine of the angle */
+static void
+variant_transform(const SpriteVariants *variants, int slot, int *frame,
+                  float *scale, float *cos_a, float *sin_a)
+{
+    const int per_frame = variants->angle_steps * variants->scale_steps;
+    const int bucket = slot % per_frame;
+    const float angle = (float)(bucket % variants->angle_steps) *
+                        (float)M_PI2 / (float)variants->angle_steps;
+
+    *frame = slot / per_frame;
+    *scale = variants->scale_min +
+             (float)(bucket / variants->angle_steps) * variants->scale_step;
+    *cos_a = cosf(angle);
+    *sin_a = sinf(angle);
+}
+
+SpriteVariants *
+sprite_variants_new(SpriteAtlas *source, int angle_steps, int scale_steps,
+                    float scale_min, float scale_max)
+{
+    const int64_t num_slots = (int64_t)source->num_frames * angle_steps * scale_steps;
+    if (num_slots > INT_MAX / 2) {
+        PyErr_SetString(PyExc_ValueError, "Too many rotation and scale steps");
+        return NULL;
+    }
+
+    SpriteVariants *variants =
+        PyMem_Malloc(sizeof(SpriteVariants) + num_slots * sizeof(VariantSlot));
+    if (!variants) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    variants->angle_steps = angle_steps;
+    variants->scale_steps = scale_steps;
+    variants->scale_min = scale_min;
+    variants->scale_step =
+        scale_steps > 1 ? (scale_max - scale_min) / (float)(scale_steps - 1) : 0.0f;
+    variants->refcount = 1;
+
+    /* Every slot gets the bounding box of its rotated and scaled frame, the
+     * boxes are stacked like the frames of a regular atlas */
+    AtlasFrame *frames = PyMem_New(AtlasFrame, num_slots);
+    if (!frames) {
+        PyMem_Free(variants);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    int64_t rows = 0;
+    int max_w = 0;
+
+    for (int slot = 0; slot < num_slots; slot++) {
+        int frame;
+        float scale, cos_a, sin_a;
+        variant_transform(variants, slot, &frame, &scale, &cos_a, &sin_a);
+
+        const AtlasFrame *src = &source->frames[frame];
+        const float w = src->width * scale, h = src->height * scale;
+
+        frames[slot].average = src->average;
+
+        /* The small bias keeps float noise at right angles from adding a row */
+        frames[slot].width =
+            MAX((int)ceilf(fabsf(w * cos_a) + fabsf(h * sin_a) - 1e-3f), 1);
+        frames[slot].height =
+            MAX((int)ceilf(fabsf(w * sin_a) + fabsf(h * cos_a) - 1e-3f), 1);
+
+        variants->slots[slot].dx = (int)floorf((src->width - frames[slot].width) * 0.5f);
+        variants->slots[slot].dy =
+            (int)floorf((src->height - frames[slot].height) * 0.5f);
+        variants->slots[slot].pixels = NULL;
+        variants->slots[slot].memory = NULL;
+
+        rows += frames[slot].height;
+        max_w = MAX(max_w, frames[slot].width);
+    }
+
+    const int pitch = (max_w + ATLAS_ROW_ALIGN - 1) & ~(ATLAS_ROW_ALIGN - 1);
+
+    /* Slots are only allocated once drawn, this bounds them all drawn at once */
+    if (rows * pitch > INT_MAX) {
+        PyMem_Free(frames);
+        PyMem_Free(variants);
+        PyErr_SetString(PyExc_ValueError, "Too many rotation and scale steps");
+        return NULL;
+    }
+
+    variants->atlas = alloc_atlas_frames(pitch, (int)num_slots);
+    if (!variants->atlas) {
+        PyMem_Free(frames);
+        PyMem_Free(variants);
+        return NULL;
+    }
+
+    SpriteAtlas *atlas = variants->atlas;
+    atlas->format = source->format;
+    atlas->Ridx = source->Ridx;
+    atlas->Gidx = source->Gidx;
+    atlas->Bidx = source->Bidx;
+
+    /* Every slot is its own allocation, so its pixels start at offset 0 */
+    for (int slot = 0; slot < num_slots; slot++) {
+        atlas->frames[slot] = frames[slot];
+        atlas->frames[slot].offset = 0;
+    }
+
+    PyMem_Free(frames);
+
+    sprite_atlas_incref(source);
+    variants->source = source;
+
+    return variants;
+}
+
+void
+sprite_variants_incref(SpriteVariants *variants)
+{
+    variants->refcount++;
+}
+
+void
+sprite_variants_decref(SpriteVariants *variants)
+{
+    if (!variants || --variants->refcount > 0)
+        return;
+
+    for (int slot = 0; slot < variants->atlas->num_frames; slot++)
+        PyMem_Free(variants->slots[slot].memory);
+
+    sprite_atlas_decref(variants->source);
+    free_atlas(variants->atlas);
+    PyMem_Free(variants);
+}
+
+/* Nearest neighbour, so every pixel keeps a color of the source frame and
+ * what falls outside of it stays zero */
+int
+sprite_variant_render(SpriteVariants *variants, int slot)
+{
+    int frame;
+    float scale, cos_a, sin_a;
+    variant_transform(variants, slot, &frame, &scale, &cos_a, &sin_a);
+
+    const SpriteAtlas *source = variants->source;
+    const AtlasFrame *src_frame = &source->frames[frame];
+    const AtlasFrame *dst_frame = &variants->atlas->frames[slot];
+    const uint32_t *src = atlas_frame_pixels(source, frame);
+
+    VariantSlot *variant = &variants->slots[slot];
+    uint32_t *pixels =
+        alloc_pixels(variants->atlas->pitch, dst_frame->height, &variant->memory);
+    if (!pixels)
+        return 0;
+
+    uint32_t *dst = pixels;
+
+    const float inv_scale = 1.0f / scale;
+    const float src_cx = src_frame->width * 0.5f, src_cy = src_frame->height * 0.5f;
+    const float dst_cx = dst_frame->width * 0.5f, dst_cy = dst_frame->height * 0.5f;
+
+    /* Each destination pixel center is rotated back into the source frame */
+    for (int y = 0; y < dst_frame->height; y++) {
+        const float dv = y + 0.5f - dst_cy;
+
+        for (int x = 0; x < dst_frame->width; x++) {
+            const float du = x + 0.5f - dst_cx;
+            const float sx = (du * cos_a - dv * sin_a) * inv_scale + src_cx;
+            const float sy = (du * sin_a + dv * cos_a) * inv_scale + src_cy;
+
+            if (sx >= 0.0f && sx < src_frame->width && sy >= 0.0f &&
+                sy < src_frame->height)
+                dst[x] = src[(int)sy * source->pitch + (int)sx];
+        }
+
+        dst += variants->atlas->pitch;
+    }
+
+    variant->pixels = pixels;
+
+    return 1;
+}
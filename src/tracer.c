@@ -0,0 +1,155 @@
+#include "include/tracer.h"
+
+enum {
+    _RING_FREE,
+    _RING_CLAIMED,
+    _RING_READY,
+};
+
+Tracer *
+tracer_new(void)
+{
+    Tracer *tracer = PyMem_Calloc(1, sizeof(Tracer));
+    if (!tracer) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    tracer->start = SDL_GetPerformanceCounter();
+
+    return tracer;
+}
+
+void
+tracer_free(Tracer *tracer)
+{
+    if (!tracer)
+        return;
+
+    for (int i = 0; i < TRACE_MAX_THREADS; i++)
+        free(tracer->rings[i].events);
+
+    PyMem_Free(tracer);
+}
+
+static TraceRing *
+claim_ring(Tracer *tracer, SDL_threadID tid)
+{
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        TraceRing *ring = &tracer->rings[i];
+        if (SDL_AtomicGet(&ring->state) == _RING_READY && ring->tid == tid)
+            return ring;
+    }
+
+    /* First event from this thread. Rings are never released, so a slot that
+     * was claimed stays with its thread for the tracer's lifetime. This may
+     * run outside the GIL, hence malloc instead of PyMem */
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        TraceRing *ring = &tracer->rings[i];
+        if (!SDL_AtomicCAS(&ring->state, _RING_FREE, _RING_CLAIMED))
+            continue;
+
+        ring->events = malloc(TRACE_RING_SIZE * sizeof(TraceEvent));
+        if (!ring->events) {
+            /* keep the slot claimed but unusable, events will be dropped */
+            return NULL;
+        }
+
+        ring->tid = tid;
+        ring->written = 0;
+        SDL_AtomicSet(&ring->state, _RING_READY);
+
+        return ring;
+    }
+
+    return NULL;
+}
+
+void
+tracer_record(Tracer *tracer, const char *name, char phase, int arg)
+{
+    const uint64_t ts = SDL_GetPerformanceCounter();
+
+    TraceRing *ring = claim_ring(tracer, SDL_ThreadID());
+    if (!ring) {
+        SDL_AtomicAdd(&tracer->dropped, 1);
+        return;
+    }
+
+    TraceEvent *event = &ring->events[ring->written % TRACE_RING_SIZE];
+    event->name = name;
+    event->ts = ts;
+    event->arg = arg;
+    event->phase = phase;
+
+    ring->written++;
+}
+
+static void
+write_ring(FILE *f, const Tracer *tracer, const TraceRing *ring, double us_per_tick,
+           bool *first)
+{
+    uint64_t begin = 0;
+    if (ring->written > TRACE_RING_SIZE)
+        begin = ring->written - TRACE_RING_SIZE;
+
+    /* After a wrap the oldest events may be ends of spans whose begin was
+     * overwritten, skip them so the viewer doesn't close unrelated spans */
+    int depth = 0;
+
+    for (uint64_t i = begin; i < ring->written; i++) {
+        const TraceEvent *e = &ring->events[i % TRACE_RING_SIZE];
+
+        if (e->phase == 'E') {
+            if (depth == 0)
+                continue;
+            depth--;
+        }
+        else {
+            depth++;
+        }
+
+        const double ts = (double)(e->ts - tracer->start) * us_per_tick;
+
+        fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"particles\",\"ph\":\"%c\","
+                "\"ts\":%.3f,\"pid\":1,\"tid\":%lu",
+                *first ? "" : ",", e->name, e->phase, ts, (unsigned long)ring->tid);
+
+        if (e->arg >= 0)
+            fprintf(f, ",\"args\":{\"index\":%d}", e->arg);
+
+        fputc('}', f);
+        *first = false;
+    }
+}
+
+int
+tracer_dump(const Tracer *tracer, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+        return 0;
+    }
+
+    const double us_per_tick = 1e6 / (double)SDL_GetPerformanceFrequency();
+    bool first = true;
+
+    fputs("{\"traceEvents\":[", f);
+
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        const TraceRing *ring = &tracer->rings[i];
+        if (SDL_AtomicGet((SDL_atomic_t *)&ring->state) == _RING_READY)
+            write_ring(f, tracer, ring, us_per_tick, &first);
+    }
+
+    fprintf(f, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":%d}}\n",
+            SDL_AtomicGet((SDL_atomic_t *)&tracer->dropped));
+
+    if (fclose(f) != 0) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+        return 0;
+    }
+
+    return 1;
+}
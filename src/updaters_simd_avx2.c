@@ -17,7 +17,7 @@ _Has_AVX2()
 {
 #if defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
     !defined(SDL_DISABLE_IMMINTRIN_H)
-    return SDL_HasAVX2();
+    return max_simd_level >= _SIMD_AVX2 && SDL_HasAVX2();
 #else
     return 0;
 #endif /* defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
@@ -26,18 +26,64 @@ _Has_AVX2()
 
 #if defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
     !defined(SDL_DISABLE_IMMINTRIN_H)
-void
-update_with_acceleration_avx2(DataBlock *block, float dt)
+#if ENABLE_F16C
+static FORCEINLINE __m256
+load_half_avx2(const uint16_t *src)
 {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)src));
+}
+
+static FORCEINLINE __m256
+load_half_partial_avx2(const uint16_t *src, int count)
+{
+    uint16_t tail[8] = {0};
+    memcpy(tail, src, count * sizeof(uint16_t));
+
+    return load_half_avx2(tail);
+}
+#endif /* ENABLE_F16C */
+
+/* Compact variants are never picked without F16C, see
+ * choose_and_set_update_function */
+static FORCEINLINE __m256
+load_acceleration_avx2(const float *acc, const uint16_t *acc_h, const bool compact)
+{
+#if ENABLE_F16C
+    if (compact)
+        return load_half_avx2(acc_h);
+#endif /* ENABLE_F16C */
+
+    return _mm256_loadu_ps(acc);
+}
+
+static FORCEINLINE __m256
+load_acceleration_partial_avx2(const float *acc, const uint16_t *acc_h,
+                               const bool compact, __m256i load_mask, int count)
+{
+#if ENABLE_F16C
+    if (compact)
+        return load_half_partial_avx2(acc_h, count);
+#endif /* ENABLE_F16C */
+
+    return _mm256_maskload_ps(acc, load_mask);
+}
+
+/* Shared body of the AVX2 updaters, see DEFINE_UPDATER_TABLE */
+static FORCEINLINE void
+update_particles_avx2(DataBlock *block, float dt, const int features)
+{
+    const bool compact = features & _UPDATE_COMPACT;
+
     float *restrict positions_x = block->positions_x.data;
     float *restrict positions_y = block->positions_y.data;
     float *restrict velocities_x = block->velocities_x.data;
     float *restrict velocities_y = block->velocities_y.data;
-    float *restrict accelerations_x = block->accelerations_x.data;
-    float *restrict accelerations_y = block->accelerations_y.data;
-    float *restrict lifetimes = block->lifetimes.data;
+    float const *restrict accelerations_x = block->accelerations_x.data;
+    float const *restrict accelerations_y = block->accelerations_y.data;
+    uint16_t const *restrict accelerations_x_h = block->accelerations_x_h.data;
+    uint16_t const *restrict accelerations_y_h = block->accelerations_y_h.data;
 
-    const int n_iters_8 = block->particles_count / 8;
+    const int n_full = block->particles_count / 8 * 8;
     const int n_excess = block->particles_count % 8;
     const __m256 dt_v = _mm256_set1_ps(dt);
     const __m256i load_mask = _mm256_set_epi32(
@@ -47,83 +93,116 @@ update_with_acceleration_avx2(DataBlock *block, float dt)
 
     int i;
 
-    for (i = 0; i < n_iters_8; i++) {
-        __m256 ax = _mm256_loadu_ps(accelerations_x);
-        __m256 ay = _mm256_loadu_ps(accelerations_y);
-        __m256 vx = _mm256_loadu_ps(velocities_x);
-        __m256 vy = _mm256_loadu_ps(velocities_y);
-        __m256 px = _mm256_loadu_ps(positions_x);
-        __m256 py = _mm256_loadu_ps(positions_y);
-        __m256 t = _mm256_loadu_ps(lifetimes);
-
-        vx = _mm256_add_ps(vx, _mm256_mul_ps(ax, dt_v));
-        vy = _mm256_add_ps(vy, _mm256_mul_ps(ay, dt_v));
+    for (i = 0; i < n_full; i += 8) {
+        __m256 vx = _mm256_loadu_ps(velocities_x + i);
+        __m256 vy = _mm256_loadu_ps(velocities_y + i);
+        __m256 px = _mm256_loadu_ps(positions_x + i);
+        __m256 py = _mm256_loadu_ps(positions_y + i);
+
+        if (features & _UPDATE_ACC_X) {
+            __m256 ax = load_acceleration_avx2(accelerations_x + i,
+                                               accelerations_x_h + i, compact);
+            vx = _mm256_add_ps(vx, _mm256_mul_ps(ax, dt_v));
+            _mm256_storeu_ps(velocities_x + i, vx);
+        }
+        if (features & _UPDATE_ACC_Y) {
+            __m256 ay = load_acceleration_avx2(accelerations_y + i,
+                                               accelerations_y_h + i, compact);
+            vy = _mm256_add_ps(vy, _mm256_mul_ps(ay, dt_v));
+            _mm256_storeu_ps(velocities_y + i, vy);
+        }
 
         px = _mm256_add_ps(px, _mm256_mul_ps(vx, dt_v));
         py = _mm256_add_ps(py, _mm256_mul_ps(vy, dt_v));
 
-        t = _mm256_sub_ps(t, dt_v);
-
-        _mm256_storeu_ps(velocities_x, vx);
-        _mm256_storeu_ps(velocities_y, vy);
-        _mm256_storeu_ps(positions_x, px);
-        _mm256_storeu_ps(positions_y, py);
-        _mm256_storeu_ps(lifetimes, t);
-
-        accelerations_x += 8;
-        accelerations_y += 8;
-        velocities_x += 8;
-        velocities_y += 8;
-        positions_x += 8;
-        positions_y += 8;
-        lifetimes += 8;
+        _mm256_storeu_ps(positions_x + i, px);
+        _mm256_storeu_ps(positions_y + i, py);
     }
 
     if (n_excess) {
-        __m256 ax = _mm256_maskload_ps(accelerations_x, load_mask);
-        __m256 ay = _mm256_maskload_ps(accelerations_y, load_mask);
-        __m256 vx = _mm256_maskload_ps(velocities_x, load_mask);
-        __m256 vy = _mm256_maskload_ps(velocities_y, load_mask);
-        __m256 px = _mm256_maskload_ps(positions_x, load_mask);
-        __m256 py = _mm256_maskload_ps(positions_y, load_mask);
-        __m256 t = _mm256_maskload_ps(lifetimes, load_mask);
-
-        vx = _mm256_add_ps(vx, _mm256_mul_ps(ax, dt_v));
-        vy = _mm256_add_ps(vy, _mm256_mul_ps(ay, dt_v));
+        __m256 vx = _mm256_maskload_ps(velocities_x + i, load_mask);
+        __m256 vy = _mm256_maskload_ps(velocities_y + i, load_mask);
+        __m256 px = _mm256_maskload_ps(positions_x + i, load_mask);
+        __m256 py = _mm256_maskload_ps(positions_y + i, load_mask);
+
+        if (features & _UPDATE_ACC_X) {
+            __m256 ax = load_acceleration_partial_avx2(
+                accelerations_x + i, accelerations_x_h + i, compact, load_mask,
+                n_excess);
+            vx = _mm256_add_ps(vx, _mm256_mul_ps(ax, dt_v));
+            _mm256_maskstore_ps(velocities_x + i, load_mask, vx);
+        }
+        if (features & _UPDATE_ACC_Y) {
+            __m256 ay = load_acceleration_partial_avx2(
+                accelerations_y + i, accelerations_y_h + i, compact, load_mask,
+                n_excess);
+            vy = _mm256_add_ps(vy, _mm256_mul_ps(ay, dt_v));
+            _mm256_maskstore_ps(velocities_y + i, load_mask, vy);
+        }
 
         px = _mm256_add_ps(px, _mm256_mul_ps(vx, dt_v));
         py = _mm256_add_ps(py, _mm256_mul_ps(vy, dt_v));
 
-        t = _mm256_sub_ps(t, dt_v);
-
-        _mm256_maskstore_ps(velocities_x, load_mask, vx);
-        _mm256_maskstore_ps(velocities_y, load_mask, vy);
-        _mm256_maskstore_ps(positions_x, load_mask, px);
-        _mm256_maskstore_ps(positions_y, load_mask, py);
-        _mm256_maskstore_ps(lifetimes, load_mask, t);
+        _mm256_maskstore_ps(positions_x + i, load_mask, px);
+        _mm256_maskstore_ps(positions_y + i, load_mask, py);
     }
 }
 #else
-void
-update_with_acceleration_avx2(DataBlock *block, float dt)
+static FORCEINLINE void
+update_particles_avx2(DataBlock *block, float dt, const int features)
 {
     BAD_AVX2_FUNCTION_CALL
 }
 #endif /* defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
           \ !defined(SDL_DISABLE_IMMINTRIN_H) */
 
+DEFINE_UPDATER_TABLE(updaters_avx2, update_particles_avx2)
+
 #if defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
     !defined(SDL_DISABLE_IMMINTRIN_H)
+static FORCEINLINE void
+accumulate_attractors_avx2(__m256 px, __m256 py, __m256 *ax, __m256 *ay,
+                           const Attractor *attractors, int count)
+{
+    const __m256 one_v = _mm256_set1_ps(1.0f);
+
+    for (int j = 0; j < count; j++) {
+        const Attractor *a = &attractors[j];
+        const __m256 strength_v = _mm256_set1_ps(a->strength);
+        const __m256 radius_v = _mm256_set1_ps(a->radius);
+        const __m256 radius2_v = _mm256_set1_ps(a->radius * a->radius);
+
+        __m256 dx = _mm256_sub_ps(_mm256_set1_ps(a->position.x), px);
+        __m256 dy = _mm256_sub_ps(_mm256_set1_ps(a->position.y), py);
+        __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        d2 = _mm256_max_ps(d2, one_v);
+        __m256 d = _mm256_sqrt_ps(d2);
+
+        __m256 mag;
+        if (a->falloff == _FALLOFF_LINEAR)
+            mag = _mm256_div_ps(
+                _mm256_mul_ps(strength_v,
+                              _mm256_sub_ps(one_v, _mm256_div_ps(d, radius_v))),
+                d);
+        else
+            mag = _mm256_div_ps(strength_v, _mm256_mul_ps(d2, d));
+
+        __m256 inside = _mm256_cmp_ps(d2, radius2_v, _CMP_LT_OQ);
+
+        *ax = _mm256_add_ps(*ax, _mm256_and_ps(inside, _mm256_mul_ps(dx, mag)));
+        *ay = _mm256_add_ps(*ay, _mm256_and_ps(inside, _mm256_mul_ps(dy, mag)));
+    }
+}
+
 void
-update_with_no_acceleration_avx2(DataBlock *block, float dt)
+apply_attractors_avx2(DataBlock *block, const Attractor *attractors, int count,
+                      float dt)
 {
     float *restrict positions_x = block->positions_x.data;
     float *restrict positions_y = block->positions_y.data;
     float *restrict velocities_x = block->velocities_x.data;
     float *restrict velocities_y = block->velocities_y.data;
-    float *restrict lifetimes = block->lifetimes.data;
 
-    int i;
     const int n_iters_8 = block->particles_count / 8;
     const int n_excess = block->particles_count % 8;
     const __m256 dt_v = _mm256_set1_ps(dt);
@@ -132,49 +211,49 @@ update_with_no_acceleration_avx2(DataBlock *block, float dt)
         n_excess > 3 ? -1 : 0, n_excess > 2 ? -1 : 0, n_excess > 1 ? -1 : 0,
         n_excess > 0 ? -1 : 0);
 
-    for (i = 0; i < n_iters_8; i++) {
-        __m256 vx = _mm256_loadu_ps(velocities_x);
-        __m256 vy = _mm256_loadu_ps(velocities_y);
+    for (int i = 0; i < n_iters_8; i++) {
         __m256 px = _mm256_loadu_ps(positions_x);
         __m256 py = _mm256_loadu_ps(positions_y);
-        __m256 t = _mm256_loadu_ps(lifetimes);
+        __m256 vx = _mm256_loadu_ps(velocities_x);
+        __m256 vy = _mm256_loadu_ps(velocities_y);
+        __m256 ax = _mm256_setzero_ps();
+        __m256 ay = _mm256_setzero_ps();
 
-        px = _mm256_add_ps(px, _mm256_mul_ps(vx, dt_v));
-        py = _mm256_add_ps(py, _mm256_mul_ps(vy, dt_v));
+        accumulate_attractors_avx2(px, py, &ax, &ay, attractors, count);
 
-        t = _mm256_sub_ps(t, dt_v);
+        vx = _mm256_add_ps(vx, _mm256_mul_ps(ax, dt_v));
+        vy = _mm256_add_ps(vy, _mm256_mul_ps(ay, dt_v));
 
-        _mm256_storeu_ps(positions_x, px);
-        _mm256_storeu_ps(positions_y, py);
-        _mm256_storeu_ps(lifetimes, t);
+        _mm256_storeu_ps(velocities_x, vx);
+        _mm256_storeu_ps(velocities_y, vy);
 
-        velocities_x += 8;
-        velocities_y += 8;
         positions_x += 8;
         positions_y += 8;
-        lifetimes += 8;
+        velocities_x += 8;
+        velocities_y += 8;
     }
 
     if (n_excess) {
-        __m256 vx = _mm256_maskload_ps(velocities_x, load_mask);
-        __m256 vy = _mm256_maskload_ps(velocities_y, load_mask);
         __m256 px = _mm256_maskload_ps(positions_x, load_mask);
         __m256 py = _mm256_maskload_ps(positions_y, load_mask);
-        __m256 t = _mm256_maskload_ps(lifetimes, load_mask);
+        __m256 vx = _mm256_maskload_ps(velocities_x, load_mask);
+        __m256 vy = _mm256_maskload_ps(velocities_y, load_mask);
+        __m256 ax = _mm256_setzero_ps();
+        __m256 ay = _mm256_setzero_ps();
 
-        px = _mm256_add_ps(px, _mm256_mul_ps(vx, dt_v));
-        py = _mm256_add_ps(py, _mm256_mul_ps(vy, dt_v));
+        accumulate_attractors_avx2(px, py, &ax, &ay, attractors, count);
 
-        t = _mm256_sub_ps(t, dt_v);
+        vx = _mm256_add_ps(vx, _mm256_mul_ps(ax, dt_v));
+        vy = _mm256_add_ps(vy, _mm256_mul_ps(ay, dt_v));
 
-        _mm256_maskstore_ps(positions_x, load_mask, px);
-        _mm256_maskstore_ps(positions_y, load_mask, py);
-        _mm256_maskstore_ps(lifetimes, load_mask, t);
+        _mm256_maskstore_ps(velocities_x, load_mask, vx);
+        _mm256_maskstore_ps(velocities_y, load_mask, vy);
     }
 }
 #else
 void
-update_with_no_acceleration_avx2(DataBlock *block, float dt)
+apply_attractors_avx2(DataBlock *block, const Attractor *attractors, int count,
+                      float dt)
 {
     BAD_AVX2_FUNCTION_CALL
 }
@@ -183,78 +262,101 @@ update_with_no_acceleration_avx2(DataBlock *block, float dt)
 
 #if defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
     !defined(SDL_DISABLE_IMMINTRIN_H)
+static FORCEINLINE void
+sample_noise_avx2(__m256 px, __m256 py, __m256 freq_v, __m256 offset_v,
+                  __m256 *nx, __m256 *ny)
+{
+    const __m256i mask_v = _mm256_set1_epi32(NOISE_LATTICE_MASK);
+    const __m256i one_v = _mm256_set1_epi32(1);
+
+    __m256 u = _mm256_mul_ps(px, freq_v);
+    __m256 v = _mm256_add_ps(_mm256_mul_ps(py, freq_v), offset_v);
+    __m256 fu = _mm256_floor_ps(u);
+    __m256 fv = _mm256_floor_ps(v);
+    __m256 tx = _mm256_sub_ps(u, fu);
+    __m256 ty = _mm256_sub_ps(v, fv);
+
+    __m256i x0 = _mm256_and_si256(_mm256_cvttps_epi32(fu), mask_v);
+    __m256i y0 = _mm256_and_si256(_mm256_cvttps_epi32(fv), mask_v);
+    __m256i x1 = _mm256_and_si256(_mm256_add_epi32(x0, one_v), mask_v);
+    __m256i y1 = _mm256_and_si256(_mm256_add_epi32(y0, one_v), mask_v);
+    y0 = _mm256_slli_epi32(y0, NOISE_LATTICE_BITS);
+    y1 = _mm256_slli_epi32(y1, NOISE_LATTICE_BITS);
+
+    __m256i i00 = _mm256_or_si256(y0, x0);
+    __m256i i10 = _mm256_or_si256(y0, x1);
+    __m256i i01 = _mm256_or_si256(y1, x0);
+    __m256i i11 = _mm256_or_si256(y1, x1);
+
+    __m256 c00 = _mm256_i32gather_ps(curl_noise_x, i00, 4);
+    __m256 c10 = _mm256_i32gather_ps(curl_noise_x, i10, 4);
+    __m256 c01 = _mm256_i32gather_ps(curl_noise_x, i01, 4);
+    __m256 c11 = _mm256_i32gather_ps(curl_noise_x, i11, 4);
+
+    __m256 top = _mm256_add_ps(c00, _mm256_mul_ps(_mm256_sub_ps(c10, c00), tx));
+    __m256 bot = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_sub_ps(c11, c01), tx));
+    *nx = _mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bot, top), ty));
+
+    c00 = _mm256_i32gather_ps(curl_noise_y, i00, 4);
+    c10 = _mm256_i32gather_ps(curl_noise_y, i10, 4);
+    c01 = _mm256_i32gather_ps(curl_noise_y, i01, 4);
+    c11 = _mm256_i32gather_ps(curl_noise_y, i11, 4);
+
+    top = _mm256_add_ps(c00, _mm256_mul_ps(_mm256_sub_ps(c10, c00), tx));
+    bot = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_sub_ps(c11, c01), tx));
+    *ny = _mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bot, top), ty));
+}
+
 void
-update_with_acceleration_x_avx2(DataBlock *block, float dt)
+apply_noise_avx2(DataBlock *block, float dt)
 {
     float *restrict positions_x = block->positions_x.data;
     float *restrict positions_y = block->positions_y.data;
-    float *restrict velocities_x = block->velocities_x.data;
-    float *restrict velocities_y = block->velocities_y.data;
-    float *restrict accelerations_x = block->accelerations_x.data;
-    float *restrict lifetimes = block->lifetimes.data;
 
     const int n_iters_8 = block->particles_count / 8;
     const int n_excess = block->particles_count % 8;
-    const __m256 dt_v = _mm256_set1_ps(dt);
+    const __m256 freq_v = _mm256_set1_ps(block->noise.frequency);
+    const __m256 offset_v = _mm256_set1_ps(block->noise_offset);
+    const __m256 scale_v = _mm256_set1_ps(block->noise.strength * dt);
     const __m256i load_mask = _mm256_set_epi32(
         0, n_excess > 6 ? -1 : 0, n_excess > 5 ? -1 : 0, n_excess > 4 ? -1 : 0,
         n_excess > 3 ? -1 : 0, n_excess > 2 ? -1 : 0, n_excess > 1 ? -1 : 0,
         n_excess > 0 ? -1 : 0);
 
-    int i;
-
-    for (i = 0; i < n_iters_8; i++) {
-        __m256 ax = _mm256_loadu_ps(accelerations_x);
-        __m256 vx = _mm256_loadu_ps(velocities_x);
-        __m256 vy = _mm256_loadu_ps(velocities_y);
+    for (int i = 0; i < n_iters_8; i++) {
         __m256 px = _mm256_loadu_ps(positions_x);
         __m256 py = _mm256_loadu_ps(positions_y);
-        __m256 t = _mm256_loadu_ps(lifetimes);
-
-        vx = _mm256_add_ps(vx, _mm256_mul_ps(ax, dt_v));
+        __m256 nx, ny;
 
-        px = _mm256_add_ps(px, _mm256_mul_ps(vx, dt_v));
-        py = _mm256_add_ps(py, _mm256_mul_ps(vy, dt_v));
+        sample_noise_avx2(px, py, freq_v, offset_v, &nx, &ny);
 
-        t = _mm256_sub_ps(t, dt_v);
+        px = _mm256_add_ps(px, _mm256_mul_ps(nx, scale_v));
+        py = _mm256_add_ps(py, _mm256_mul_ps(ny, scale_v));
 
-        _mm256_storeu_ps(velocities_x, vx);
         _mm256_storeu_ps(positions_x, px);
         _mm256_storeu_ps(positions_y, py);
-        _mm256_storeu_ps(lifetimes, t);
 
-        accelerations_x += 8;
-        velocities_x += 8;
-        velocities_y += 8;
         positions_x += 8;
         positions_y += 8;
-        lifetimes += 8;
     }
 
     if (n_excess) {
-        __m256 ax = _mm256_maskload_ps(accelerations_x, load_mask);
-        __m256 vx = _mm256_maskload_ps(velocities_x, load_mask);
-        __m256 vy = _mm256_maskload_ps(velocities_y, load_mask);
         __m256 px = _mm256_maskload_ps(positions_x, load_mask);
         __m256 py = _mm256_maskload_ps(positions_y, load_mask);
-        __m256 t = _mm256_maskload_ps(lifetimes, load_mask);
-
-        vx = _mm256_add_ps(vx, _mm256_mul_ps(ax, dt_v));
+        __m256 nx, ny;
 
-        px = _mm256_add_ps(px, _mm256_mul_ps(vx, dt_v));
-        py = _mm256_add_ps(py, _mm256_mul_ps(vy, dt_v));
+        sample_noise_avx2(px, py, freq_v, offset_v, &nx, &ny);
 
-        t = _mm256_sub_ps(t, dt_v);
+        px = _mm256_add_ps(px, _mm256_mul_ps(nx, scale_v));
+        py = _mm256_add_ps(py, _mm256_mul_ps(ny, scale_v));
 
-        _mm256_maskstore_ps(velocities_x, load_mask, vx);
         _mm256_maskstore_ps(positions_x, load_mask, px);
         _mm256_maskstore_ps(positions_y, load_mask, py);
-        _mm256_maskstore_ps(lifetimes, load_mask, t);
     }
 }
 #else
 void
-update_with_acceleration_x_avx2(DataBlock *block, float dt)
+apply_noise_avx2(DataBlock *block, float dt)
 {
     BAD_AVX2_FUNCTION_CALL
 }
@@ -263,19 +365,47 @@ update_with_acceleration_x_avx2(DataBlock *block, float dt)
 
 #if defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
     !defined(SDL_DISABLE_IMMINTRIN_H)
-void
-update_with_acceleration_y_avx2(DataBlock *block, float dt)
+static FORCEINLINE void
+bounce_axis_avx2(__m256 *p, __m256 *v_normal, __m256 *v_tangent, __m256 lo_v,
+                 __m256 hi_v, __m256 neg_restitution_v, __m256 keep_v)
+{
+    __m256 lo = _mm256_cmp_ps(*p, lo_v, _CMP_LT_OQ);
+    __m256 hi = _mm256_cmp_ps(*p, hi_v, _CMP_GT_OQ);
+    __m256 hit = _mm256_or_ps(lo, hi);
+
+    *p = _mm256_blendv_ps(*p, lo_v, lo);
+    *p = _mm256_blendv_ps(*p, hi_v, hi);
+    *v_normal =
+        _mm256_blendv_ps(*v_normal, _mm256_mul_ps(*v_normal, neg_restitution_v), hit);
+    *v_tangent = _mm256_blendv_ps(*v_tangent, _mm256_mul_ps(*v_tangent, keep_v), hit);
+}
+
+static FORCEINLINE __m256
+outside_bounds_avx2(__m256 px, __m256 py, __m256 left_v, __m256 top_v,
+                    __m256 right_v, __m256 bottom_v)
+{
+    __m256 hx = _mm256_or_ps(_mm256_cmp_ps(px, left_v, _CMP_LT_OQ),
+                             _mm256_cmp_ps(px, right_v, _CMP_GT_OQ));
+    __m256 hy = _mm256_or_ps(_mm256_cmp_ps(py, top_v, _CMP_LT_OQ),
+                             _mm256_cmp_ps(py, bottom_v, _CMP_GT_OQ));
+
+    return _mm256_or_ps(hx, hy);
+}
+
+int
+collide_bounds_avx2(DataBlock *block, const CollisionBounds *bounds)
 {
     float *restrict positions_x = block->positions_x.data;
     float *restrict positions_y = block->positions_y.data;
     float *restrict velocities_x = block->velocities_x.data;
     float *restrict velocities_y = block->velocities_y.data;
-    float *restrict accelerations_y = block->accelerations_y.data;
-    float *restrict lifetimes = block->lifetimes.data;
 
     const int n_iters_8 = block->particles_count / 8;
     const int n_excess = block->particles_count % 8;
-    const __m256 dt_v = _mm256_set1_ps(dt);
+    const __m256 left_v = _mm256_set1_ps(bounds->left);
+    const __m256 top_v = _mm256_set1_ps(bounds->top);
+    const __m256 right_v = _mm256_set1_ps(bounds->right);
+    const __m256 bottom_v = _mm256_set1_ps(bounds->bottom);
     const __m256i load_mask = _mm256_set_epi32(
         0, n_excess > 6 ? -1 : 0, n_excess > 5 ? -1 : 0, n_excess > 4 ? -1 : 0,
         n_excess > 3 ? -1 : 0, n_excess > 2 ? -1 : 0, n_excess > 1 ? -1 : 0,
@@ -283,111 +413,237 @@ update_with_acceleration_y_avx2(DataBlock *block, float dt)
 
     int i;
 
+    if (bounds->response == _COLLISION_KILL) {
+        for (i = 0; i < n_iters_8; i++) {
+            __m256 px = _mm256_loadu_ps(positions_x);
+            __m256 py = _mm256_loadu_ps(positions_y);
+
+            const int hits = _mm256_movemask_ps(
+                outside_bounds_avx2(px, py, left_v, top_v, right_v, bottom_v));
+            if (hits)
+                return i * 8 + _first_lane(hits);
+
+            positions_x += 8;
+            positions_y += 8;
+        }
+
+        if (n_excess) {
+            __m256 px = _mm256_maskload_ps(positions_x, load_mask);
+            __m256 py = _mm256_maskload_ps(positions_y, load_mask);
+
+            __m256 hit = _mm256_and_ps(
+                outside_bounds_avx2(px, py, left_v, top_v, right_v, bottom_v),
+                _mm256_castsi256_ps(load_mask));
+
+            const int hits = _mm256_movemask_ps(hit);
+            if (hits)
+                return i * 8 + _first_lane(hits);
+        }
+
+        return -1;
+    }
+
+    const __m256 neg_restitution_v = _mm256_set1_ps(-bounds->restitution);
+    const __m256 keep_v = _mm256_set1_ps(1.0f - bounds->friction);
+
     for (i = 0; i < n_iters_8; i++) {
-        __m256 ay = _mm256_loadu_ps(accelerations_y);
-        __m256 vx = _mm256_loadu_ps(velocities_x);
-        __m256 vy = _mm256_loadu_ps(velocities_y);
         __m256 px = _mm256_loadu_ps(positions_x);
         __m256 py = _mm256_loadu_ps(positions_y);
-        __m256 t = _mm256_loadu_ps(lifetimes);
-
-        vy = _mm256_add_ps(vy, _mm256_mul_ps(ay, dt_v));
-
-        px = _mm256_add_ps(px, _mm256_mul_ps(vx, dt_v));
-        py = _mm256_add_ps(py, _mm256_mul_ps(vy, dt_v));
+        __m256 vx = _mm256_loadu_ps(velocities_x);
+        __m256 vy = _mm256_loadu_ps(velocities_y);
 
-        t = _mm256_sub_ps(t, dt_v);
+        bounce_axis_avx2(&px, &vx, &vy, left_v, right_v, neg_restitution_v, keep_v);
+        bounce_axis_avx2(&py, &vy, &vx, top_v, bottom_v, neg_restitution_v, keep_v);
 
-        _mm256_storeu_ps(velocities_y, vy);
         _mm256_storeu_ps(positions_x, px);
         _mm256_storeu_ps(positions_y, py);
-        _mm256_storeu_ps(lifetimes, t);
+        _mm256_storeu_ps(velocities_x, vx);
+        _mm256_storeu_ps(velocities_y, vy);
 
-        accelerations_y += 8;
-        velocities_x += 8;
-        velocities_y += 8;
         positions_x += 8;
         positions_y += 8;
-        lifetimes += 8;
+        velocities_x += 8;
+        velocities_y += 8;
     }
 
     if (n_excess) {
-        __m256 ay = _mm256_maskload_ps(accelerations_y, load_mask);
-        __m256 vx = _mm256_maskload_ps(velocities_x, load_mask);
-        __m256 vy = _mm256_maskload_ps(velocities_y, load_mask);
         __m256 px = _mm256_maskload_ps(positions_x, load_mask);
         __m256 py = _mm256_maskload_ps(positions_y, load_mask);
-        __m256 t = _mm256_maskload_ps(lifetimes, load_mask);
-
-        vy = _mm256_add_ps(vy, _mm256_mul_ps(ay, dt_v));
-
-        px = _mm256_add_ps(px, _mm256_mul_ps(vx, dt_v));
-        py = _mm256_add_ps(py, _mm256_mul_ps(vy, dt_v));
+        __m256 vx = _mm256_maskload_ps(velocities_x, load_mask);
+        __m256 vy = _mm256_maskload_ps(velocities_y, load_mask);
 
-        t = _mm256_sub_ps(t, dt_v);
+        bounce_axis_avx2(&px, &vx, &vy, left_v, right_v, neg_restitution_v, keep_v);
+        bounce_axis_avx2(&py, &vy, &vx, top_v, bottom_v, neg_restitution_v, keep_v);
 
-        _mm256_maskstore_ps(velocities_y, load_mask, vy);
         _mm256_maskstore_ps(positions_x, load_mask, px);
         _mm256_maskstore_ps(positions_y, load_mask, py);
-        _mm256_maskstore_ps(lifetimes, load_mask, t);
+        _mm256_maskstore_ps(velocities_x, load_mask, vx);
+        _mm256_maskstore_ps(velocities_y, load_mask, vy);
     }
+
+    return -1;
 }
 #else
-void
-update_with_acceleration_y_avx2(DataBlock *block, float dt)
+int
+collide_bounds_avx2(DataBlock *block, const CollisionBounds *bounds)
 {
     BAD_AVX2_FUNCTION_CALL
+    return -1;
 }
 #endif /* defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
           \ !defined(SDL_DISABLE_IMMINTRIN_H) */
 
 #if defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
     !defined(SDL_DISABLE_IMMINTRIN_H)
-void
-update_indices_avx2(DataBlock *block)
+static FORCEINLINE __m256
+grid_cell_solid_avx2(const OccupancyGrid *grid, __m256 x, __m256 y, __m256 inv_v,
+                     __m256i width_v, __m256i height_v)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i minus_one = _mm256_set1_epi32(-1);
+
+    __m256i cx = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(x, inv_v)));
+    __m256i cy = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(y, inv_v)));
+
+    __m256i inside = _mm256_and_si256(
+        _mm256_and_si256(_mm256_cmpgt_epi32(cx, minus_one),
+                         _mm256_cmpgt_epi32(width_v, cx)),
+        _mm256_and_si256(_mm256_cmpgt_epi32(cy, minus_one),
+                         _mm256_cmpgt_epi32(height_v, cy)));
+
+    /* Gather 4 bytes at each cell offset, the grid is padded so the read never
+     * runs past the allocation, and keep only the first one */
+    __m256i idx = _mm256_add_epi32(_mm256_mullo_epi32(cy, width_v), cx);
+    __m256i cells = _mm256_mask_i32gather_epi32(zero, (const int *)grid->cells, idx,
+                                                inside, 1);
+    cells = _mm256_and_si256(cells, _mm256_set1_epi32(0xFF));
+
+    return _mm256_castsi256_ps(
+        _mm256_xor_si256(_mm256_cmpeq_epi32(cells, zero), minus_one));
+}
+
+static FORCEINLINE void
+grid_bounce_avx2(const OccupancyGrid *grid, __m256 *px, __m256 *py, __m256 *vx,
+                 __m256 *vy, __m256 dt_v, __m256 neg_restitution_v, __m256 inv_v,
+                 __m256i width_v, __m256i height_v)
+{
+    const __m256 ones = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+    __m256 ox = _mm256_sub_ps(*px, _mm256_mul_ps(*vx, dt_v));
+    __m256 oy = _mm256_sub_ps(*py, _mm256_mul_ps(*vy, dt_v));
+
+    /* Probe each axis on its own to find which side was hit, if neither
+     * explains the hit it was a corner and both axes bounce */
+    __m256 hit = grid_cell_solid_avx2(grid, *px, *py, inv_v, width_v, height_v);
+    __m256 hit_x = grid_cell_solid_avx2(grid, *px, oy, inv_v, width_v, height_v);
+    __m256 hit_y = grid_cell_solid_avx2(grid, ox, *py, inv_v, width_v, height_v);
+    __m256 corner = _mm256_andnot_ps(_mm256_or_ps(hit_x, hit_y), ones);
+    __m256 flip_x = _mm256_and_ps(hit, _mm256_or_ps(hit_x, corner));
+    __m256 flip_y = _mm256_and_ps(hit, _mm256_or_ps(hit_y, corner));
+
+    *px = _mm256_blendv_ps(*px, ox, flip_x);
+    *py = _mm256_blendv_ps(*py, oy, flip_y);
+    *vx = _mm256_blendv_ps(*vx, _mm256_mul_ps(*vx, neg_restitution_v), flip_x);
+    *vy = _mm256_blendv_ps(*vy, _mm256_mul_ps(*vy, neg_restitution_v), flip_y);
+}
+
+int
+collide_grid_avx2(DataBlock *block, const OccupancyGrid *grid, float dt)
 {
-    float *restrict lifetimes = block->lifetimes.data;
-    float *restrict max_lifetimes = block->max_lifetimes.data;
-    __m256i *indices = (__m256i *)block->animation_indices;
+    float *restrict positions_x = block->positions_x.data;
+    float *restrict positions_y = block->positions_y.data;
+    float *restrict velocities_x = block->velocities_x.data;
+    float *restrict velocities_y = block->velocities_y.data;
 
     const int n_iters_8 = block->particles_count / 8;
     const int n_excess = block->particles_count % 8;
-    const __m256 one_v = _mm256_set1_ps(1.0f);
-    const __m256 num_frames_v = _mm256_set1_ps((float)(block->num_frames));
+    const __m256 inv_v = _mm256_set1_ps(grid->inv_cell_size);
+    const __m256i width_v = _mm256_set1_epi32(grid->width);
+    const __m256i height_v = _mm256_set1_epi32(grid->height);
     const __m256i load_mask = _mm256_set_epi32(
         0, n_excess > 6 ? -1 : 0, n_excess > 5 ? -1 : 0, n_excess > 4 ? -1 : 0,
         n_excess > 3 ? -1 : 0, n_excess > 2 ? -1 : 0, n_excess > 1 ? -1 : 0,
         n_excess > 0 ? -1 : 0);
 
-    for (int i = 0; i < n_iters_8; i++) {
-        __m256 t = _mm256_loadu_ps(lifetimes);
-        __m256 max_t = _mm256_loadu_ps(max_lifetimes);
+    int i;
+
+    if (grid->response == _COLLISION_KILL) {
+        for (i = 0; i < n_iters_8; i++) {
+            __m256 px = _mm256_loadu_ps(positions_x);
+            __m256 py = _mm256_loadu_ps(positions_y);
+
+            const int hits = _mm256_movemask_ps(
+                grid_cell_solid_avx2(grid, px, py, inv_v, width_v, height_v));
+            if (hits)
+                return i * 8 + _first_lane(hits);
+
+            positions_x += 8;
+            positions_y += 8;
+        }
+
+        if (n_excess) {
+            __m256 px = _mm256_maskload_ps(positions_x, load_mask);
+            __m256 py = _mm256_maskload_ps(positions_y, load_mask);
+
+            __m256 hit =
+                _mm256_and_ps(grid_cell_solid_avx2(grid, px, py, inv_v, width_v,
+                                                   height_v),
+                              _mm256_castsi256_ps(load_mask));
+
+            const int hits = _mm256_movemask_ps(hit);
+            if (hits)
+                return i * 8 + _first_lane(hits);
+        }
+
+        return -1;
+    }
+
+    const __m256 dt_v = _mm256_set1_ps(dt);
+    const __m256 neg_restitution_v = _mm256_set1_ps(-grid->restitution);
 
-        __m256i idx = _mm256_cvttps_epi32(_mm256_mul_ps(
-            _mm256_sub_ps(one_v, _mm256_div_ps(t, max_t)), num_frames_v));
+    for (i = 0; i < n_iters_8; i++) {
+        __m256 px = _mm256_loadu_ps(positions_x);
+        __m256 py = _mm256_loadu_ps(positions_y);
+        __m256 vx = _mm256_loadu_ps(velocities_x);
+        __m256 vy = _mm256_loadu_ps(velocities_y);
 
-        _mm256_storeu_si256(indices, idx);
+        grid_bounce_avx2(grid, &px, &py, &vx, &vy, dt_v, neg_restitution_v, inv_v,
+                         width_v, height_v);
 
-        lifetimes += 8;
-        max_lifetimes += 8;
-        indices++;
+        _mm256_storeu_ps(positions_x, px);
+        _mm256_storeu_ps(positions_y, py);
+        _mm256_storeu_ps(velocities_x, vx);
+        _mm256_storeu_ps(velocities_y, vy);
+
+        positions_x += 8;
+        positions_y += 8;
+        velocities_x += 8;
+        velocities_y += 8;
     }
 
     if (n_excess) {
-        __m256 t = _mm256_maskload_ps(lifetimes, load_mask);
-        __m256 max_t = _mm256_maskload_ps(max_lifetimes, load_mask);
+        __m256 px = _mm256_maskload_ps(positions_x, load_mask);
+        __m256 py = _mm256_maskload_ps(positions_y, load_mask);
+        __m256 vx = _mm256_maskload_ps(velocities_x, load_mask);
+        __m256 vy = _mm256_maskload_ps(velocities_y, load_mask);
 
-        __m256i idx = _mm256_cvttps_epi32(_mm256_mul_ps(
-            _mm256_sub_ps(one_v, _mm256_div_ps(t, max_t)), num_frames_v));
+        grid_bounce_avx2(grid, &px, &py, &vx, &vy, dt_v, neg_restitution_v, inv_v,
+                         width_v, height_v);
 
-        _mm256_maskstore_epi32((int *)indices, load_mask, idx);
+        _mm256_maskstore_ps(positions_x, load_mask, px);
+        _mm256_maskstore_ps(positions_y, load_mask, py);
+        _mm256_maskstore_ps(velocities_x, load_mask, vx);
+        _mm256_maskstore_ps(velocities_y, load_mask, vy);
     }
+
+    return -1;
 }
 #else
-void
-update_indices_avx2(DataBlock *block)
+int
+collide_grid_avx2(DataBlock *block, const OccupancyGrid *grid, float dt)
 {
     BAD_AVX2_FUNCTION_CALL
+    return -1;
 }
 #endif /* defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
           \ !defined(SDL_DISABLE_IMMINTRIN_H) */
@@ -536,91 +792,150 @@ void inline blit_add_avx2_5x5(uint32_t *srcp32, uint32_t *dstp32, int src_skip,
     *dstp32 = _mm_cvtsi128_si32(dst128);
 }
 
+/* Adds one sprite of the atlas, dst_pitch is in pixels */
 void
-blit_fragments_add_avx2(FragmentationMap *frag_map, PyObject **animation,
-                        int dst_skip)
+blit_sprite_add_avx2(const SpriteAtlas *atlas, const uint32_t *src, uint32_t *dst,
+                     int width, int rows, int dst_pitch)
 {
-    Fragment *fragments = frag_map->fragments;
-    BlitDestination *destinations = frag_map->destinations;
-
-    for (int i = 0; i < frag_map->used_f; i++) {
-        Fragment *fragment = &fragments[i];
-        SDL_Surface *src_surf =
-            ((pgSurfaceObject *)animation[fragment->animation_index])->surf;
-        uint32_t *const src_start = (uint32_t *)src_surf->pixels;
-
-        for (int j = 0; j < fragment->length; j++) {
-            BlitDestination *item = &destinations[j];
-            uint32_t *srcp32 = src_start + item->src_offset;
-            uint32_t *dstp32 = item->pixels;
-            const int src_skip = src_surf->pitch / 4 - item->width;
-            const int actual_dst_skip = dst_skip - item->width;
-
-            if (item->width == 1 && item->rows == 1) {
-                blit_add_avx2_1x1(srcp32, dstp32);
-                continue;
-            }
-            else if (item->width == 2 && item->rows == 2) {
-                blit_add_avx2_2x2(srcp32, dstp32, src_skip, actual_dst_skip);
-                continue;
-            }
-            else if (item->width == 3 && item->rows == 3) {
-                blit_add_avx2_3x3(srcp32, dstp32, src_skip, actual_dst_skip);
-                continue;
-            }
-            else if (item->width == 4 && item->rows == 4) {
-                blit_add_avx2_4x4(srcp32, dstp32, src_skip, actual_dst_skip);
-                continue;
-            }
-            else if (item->width == 5 && item->rows == 5) {
-                blit_add_avx2_5x5(srcp32, dstp32, src_skip, actual_dst_skip);
-                continue;
-            }
-
-            int h = item->rows;
-
-            const int n_iters_8 = item->width / 8;
-            const int pxl_excess = item->width % 8;
-
-            while (h--) {
-                for (int k = 0; k < n_iters_8; k++) {
-                    __m256i src256 = _mm256_loadu_si256((__m256i *)srcp32);
-                    __m256i dst256 = _mm256_loadu_si256((__m256i *)dstp32);
-
-                    dst256 = _mm256_adds_epu8(src256, dst256);
-
-                    _mm256_storeu_si256((__m256i *)dstp32, dst256);
-
-                    srcp32 += 8;
-                    dstp32 += 8;
-                }
-
-                for (int k = 0; k < pxl_excess; k++) {
-                    __m128i src128 = _mm_cvtsi32_si128(*srcp32);
-                    __m128i dst128 = _mm_cvtsi32_si128(*dstp32);
-
-                    dst128 = _mm_adds_epu8(src128, dst128);
-
-                    *dstp32 = _mm_cvtsi128_si32(dst128);
-
-                    srcp32++;
-                    dstp32++;
-                }
-
-                srcp32 += src_skip;
-                dstp32 += actual_dst_skip;
-            }
+    uint32_t *srcp32 = (uint32_t *)src;
+    uint32_t *dstp32 = dst;
+    const int src_skip = atlas->pitch - width;
+    const int actual_dst_skip = dst_pitch - width;
+
+    if (width == 1 && rows == 1) {
+        blit_add_avx2_1x1(srcp32, dstp32);
+        return;
+    }
+    else if (width == 2 && rows == 2) {
+        blit_add_avx2_2x2(srcp32, dstp32, src_skip, actual_dst_skip);
+        return;
+    }
+    else if (width == 3 && rows == 3) {
+        blit_add_avx2_3x3(srcp32, dstp32, src_skip, actual_dst_skip);
+        return;
+    }
+    else if (width == 4 && rows == 4) {
+        blit_add_avx2_4x4(srcp32, dstp32, src_skip, actual_dst_skip);
+        return;
+    }
+    else if (width == 5 && rows == 5) {
+        blit_add_avx2_5x5(srcp32, dstp32, src_skip, actual_dst_skip);
+        return;
+    }
+
+    int h = rows;
+
+    const int n_iters_8 = width / 8;
+    const int pxl_excess = width % 8;
+
+    while (h--) {
+        for (int k = 0; k < n_iters_8; k++) {
+            __m256i src256 = _mm256_loadu_si256((__m256i *)srcp32);
+            __m256i dst256 = _mm256_loadu_si256((__m256i *)dstp32);
+
+            dst256 = _mm256_adds_epu8(src256, dst256);
+
+            _mm256_storeu_si256((__m256i *)dstp32, dst256);
+
+            srcp32 += 8;
+            dstp32 += 8;
+        }
+
+        for (int k = 0; k < pxl_excess; k++) {
+            __m128i src128 = _mm_cvtsi32_si128(*srcp32);
+            __m128i dst128 = _mm_cvtsi32_si128(*dstp32);
+
+            dst128 = _mm_adds_epu8(src128, dst128);
+
+            *dstp32 = _mm_cvtsi128_si32(dst128);
+
+            srcp32++;
+            dstp32++;
         }
 
-        destinations += fragment->length;
+        srcp32 += src_skip;
+        dstp32 += actual_dst_skip;
+    }
+}
+
+void
+blit_fragments_add_avx2(FragmentationMap *frag_map, const SpriteAtlas *atlas,
+                        int dst_skip)
+{
+    const BlitDestination *destinations = frag_map->destinations;
+
+    for (int i = 0; i < frag_map->dest_count; i++) {
+        const BlitDestination *item = &destinations[i];
+        blit_sprite_add_avx2(atlas, item->src, item->pixels, item->width, item->rows,
+                             dst_skip);
+    }
+}
+
+/* Eight pixels at a time, offsets are computed like in the SSE2 version and
+ * the pixels gathered. The stores stay scalar, a streak never visits a pixel
+ * twice so the lanes can't collide */
+void
+draw_streak_add_avx2(const SpriteAtlas *atlas, const Streak *streak, uint32_t *pixels,
+                     int pitch)
+{
+    const int32_t sx = streak->step_x, sy = streak->step_y;
+    const __m256i color = _mm256_set1_epi32((int)streak->color);
+    const __m256i row_column = _mm256_set1_epi32((1 << 16) | pitch);
+    const __m256i column_mask = _mm256_set1_epi32((int)0xFFFF0000);
+    const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i step8_x = _mm256_set1_epi32(8 * sx);
+    const __m256i step8_y = _mm256_set1_epi32(8 * sy);
+
+    __m256i xs = _mm256_add_epi32(_mm256_set1_epi32(streak->x),
+                                  _mm256_mullo_epi32(lanes, _mm256_set1_epi32(sx)));
+    __m256i ys = _mm256_add_epi32(_mm256_set1_epi32(streak->y),
+                                  _mm256_mullo_epi32(lanes, _mm256_set1_epi32(sy)));
+
+    int32_t offsets[8];
+    uint32_t values[8];
+
+    for (int k = 0; k < streak->count; k += 8) {
+        const int n = MIN(streak->count - k, 8);
+        const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(n), lanes);
+
+        const __m256i cells = _mm256_or_si256(_mm256_srli_epi32(ys, 16),
+                                              _mm256_and_si256(xs, column_mask));
+        const __m256i offs = _mm256_madd_epi16(cells, row_column);
+
+        __m256i dst256 = _mm256_mask_i32gather_epi32(
+            _mm256_setzero_si256(), (const int *)pixels, offs, mask, 4);
+        dst256 = _mm256_adds_epu8(dst256, color);
+
+        _mm256_storeu_si256((__m256i *)offsets, offs);
+        _mm256_storeu_si256((__m256i *)values, dst256);
+
+        for (int i = 0; i < n; i++)
+            pixels[offsets[i]] = values[i];
+
+        xs = _mm256_add_epi32(xs, step8_x);
+        ys = _mm256_add_epi32(ys, step8_y);
     }
 }
 #else
 void
-blit_fragments_add_avx2(FragmentationMap *frag_map, PyObject **animation,
+blit_sprite_add_avx2(const SpriteAtlas *atlas, const uint32_t *src, uint32_t *dst,
+                     int width, int rows, int dst_pitch)
+{
+    BAD_AVX2_FUNCTION_CALL
+}
+
+void
+blit_fragments_add_avx2(FragmentationMap *frag_map, const SpriteAtlas *atlas,
                         int dst_skip)
 {
     BAD_AVX2_FUNCTION_CALL
 }
+
+void
+draw_streak_add_avx2(const SpriteAtlas *atlas, const Streak *streak, uint32_t *pixels,
+                     int pitch)
+{
+    BAD_AVX2_FUNCTION_CALL
+}
 #endif /* defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
           \ !defined(SDL_DISABLE_IMMINTRIN_H) */
\ No newline at end of file
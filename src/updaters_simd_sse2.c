@@ -17,292 +17,590 @@ int
 _HasSSE_NEON()
 {
 #if defined(__SSE2__)
-    return SDL_HasSSE2();
+    return max_simd_level >= _SIMD_SSE2 && SDL_HasSSE2();
 #elif ENABLE_ARM_NEON
-    return SDL_HasNEON();
+    return max_simd_level >= _SIMD_SSE2 && SDL_HasNEON();
 #else
     return 0;
 #endif
 }
 
 #if defined(__SSE2__) || defined(ENABLE_ARM_NEON)
-void
-update_with_acceleration_sse2(DataBlock *block, float dt)
+/* SSE2 version of half_to_float, widens four halves from the low 64 bits */
+static FORCEINLINE __m128
+load_half_sse2(const uint16_t *src)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i pow2_112 = _mm_set1_epi32(239 << 23);
+    const __m128i max_finite = _mm_set1_epi32(0x7BFF);
+    const __m128i exp_mask = _mm_set1_epi32(0x7F800000);
+
+    const __m128i h = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)src), zero);
+    const __m128i expmant = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+    const __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expmant), 16);
+    const __m128i infnan = _mm_and_si128(_mm_cmpgt_epi32(expmant, max_finite), exp_mask);
+
+    const __m128 f = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expmant, 13)),
+                                _mm_castsi128_ps(pow2_112));
+
+    return _mm_or_ps(f, _mm_castsi128_ps(_mm_or_si128(sign, infnan)));
+}
+
+static FORCEINLINE __m128
+load_acceleration_sse2(const float *acc, const uint16_t *acc_h, const bool compact)
 {
+    return compact ? load_half_sse2(acc_h) : _mm_loadu_ps(acc);
+}
+
+/* Shared body of the SSE2 updaters, see DEFINE_UPDATER_TABLE */
+static FORCEINLINE void
+update_particles_sse2(DataBlock *block, float dt, const int features)
+{
+    const bool compact = features & _UPDATE_COMPACT;
+
     float *restrict positions_x = block->positions_x.data;
     float *restrict positions_y = block->positions_y.data;
     float *restrict velocities_x = block->velocities_x.data;
     float *restrict velocities_y = block->velocities_y.data;
-    float *restrict accelerations_x = block->accelerations_x.data;
-    float *restrict accelerations_y = block->accelerations_y.data;
-    float *restrict lifetimes = block->lifetimes.data;
+    float const *restrict accelerations_x = block->accelerations_x.data;
+    float const *restrict accelerations_y = block->accelerations_y.data;
+    uint16_t const *restrict accelerations_x_h = block->accelerations_x_h.data;
+    uint16_t const *restrict accelerations_y_h = block->accelerations_y_h.data;
 
-    const int n_iters_4 = block->particles_count / 4;
-    const int n_excess = block->particles_count % 4;
+    const int n_full = block->particles_count / 4 * 4;
     const __m128 dt_v = _mm_set1_ps(dt);
 
     int i;
 
-    for (i = 0; i < n_iters_4; i++) {
-        __m128 ax = _mm_loadu_ps(accelerations_x);
-        __m128 ay = _mm_loadu_ps(accelerations_y);
-        __m128 vx = _mm_loadu_ps(velocities_x);
-        __m128 vy = _mm_loadu_ps(velocities_y);
-        __m128 px = _mm_loadu_ps(positions_x);
-        __m128 py = _mm_loadu_ps(positions_y);
-        __m128 t = _mm_loadu_ps(lifetimes);
+    for (i = 0; i < n_full; i += 4) {
+        __m128 vx = _mm_loadu_ps(velocities_x + i);
+        __m128 vy = _mm_loadu_ps(velocities_y + i);
+        __m128 px = _mm_loadu_ps(positions_x + i);
+        __m128 py = _mm_loadu_ps(positions_y + i);
+
+        if (features & _UPDATE_ACC_X) {
+            __m128 ax = load_acceleration_sse2(accelerations_x + i,
+                                               accelerations_x_h + i, compact);
+            vx = _mm_add_ps(vx, _mm_mul_ps(ax, dt_v));
+            _mm_storeu_ps(velocities_x + i, vx);
+        }
+        if (features & _UPDATE_ACC_Y) {
+            __m128 ay = load_acceleration_sse2(accelerations_y + i,
+                                               accelerations_y_h + i, compact);
+            vy = _mm_add_ps(vy, _mm_mul_ps(ay, dt_v));
+            _mm_storeu_ps(velocities_y + i, vy);
+        }
 
-        vx = _mm_add_ps(vx, _mm_mul_ps(ax, dt_v));
-        vy = _mm_add_ps(vy, _mm_mul_ps(ay, dt_v));
         px = _mm_add_ps(px, _mm_mul_ps(vx, dt_v));
         py = _mm_add_ps(py, _mm_mul_ps(vy, dt_v));
-        t = _mm_sub_ps(t, dt_v);
 
-        _mm_storeu_ps(velocities_x, vx);
-        _mm_storeu_ps(velocities_y, vy);
-        _mm_storeu_ps(positions_x, px);
-        _mm_storeu_ps(positions_y, py);
-        _mm_storeu_ps(lifetimes, t);
-
-        accelerations_x += 4;
-        accelerations_y += 4;
-        velocities_x += 4;
-        velocities_y += 4;
-        positions_x += 4;
-        positions_y += 4;
-        lifetimes += 4;
+        _mm_storeu_ps(positions_x + i, px);
+        _mm_storeu_ps(positions_y + i, py);
     }
 
-    for (i = 0; i < n_excess; i++) {
-        velocities_x[i] += accelerations_x[i] * dt;
-        velocities_y[i] += accelerations_y[i] * dt;
+    for (; i < block->particles_count; i++) {
+        if (features & _UPDATE_ACC_X) {
+            const float ax =
+                compact ? half_to_float(accelerations_x_h[i]) : accelerations_x[i];
+            velocities_x[i] += ax * dt;
+        }
+        if (features & _UPDATE_ACC_Y) {
+            const float ay =
+                compact ? half_to_float(accelerations_y_h[i]) : accelerations_y[i];
+            velocities_y[i] += ay * dt;
+        }
         positions_x[i] += velocities_x[i] * dt;
         positions_y[i] += velocities_y[i] * dt;
-        lifetimes[i] -= dt;
     }
 }
 #else
-void
-update_with_acceleration_sse2(DataBlock *block, float dt)
+static FORCEINLINE void
+update_particles_sse2(DataBlock *block, float dt, const int features)
 {
     BAD_SSE2_FUNCTION_CALL
 }
 #endif /* __SSE2__ || ENABLE_ARM_NEON */
 
+DEFINE_UPDATER_TABLE(updaters_sse2, update_particles_sse2)
+
 #if defined(__SSE2__) || defined(ENABLE_ARM_NEON)
 void
-update_with_no_acceleration_sse2(DataBlock *block, float dt)
+apply_attractors_sse2(DataBlock *block, const Attractor *attractors, int count,
+                      float dt)
 {
     float *restrict positions_x = block->positions_x.data;
     float *restrict positions_y = block->positions_y.data;
     float *restrict velocities_x = block->velocities_x.data;
     float *restrict velocities_y = block->velocities_y.data;
-    float *restrict lifetimes = block->lifetimes.data;
 
     const int n_iters_4 = block->particles_count / 4;
     const int n_excess = block->particles_count % 4;
     const __m128 dt_v = _mm_set1_ps(dt);
+    const __m128 one_v = _mm_set1_ps(1.0f);
 
     int i;
 
     for (i = 0; i < n_iters_4; i++) {
-        __m128 vx = _mm_loadu_ps(velocities_x);
-        __m128 vy = _mm_loadu_ps(velocities_y);
         __m128 px = _mm_loadu_ps(positions_x);
         __m128 py = _mm_loadu_ps(positions_y);
-        __m128 t = _mm_loadu_ps(lifetimes);
+        __m128 vx = _mm_loadu_ps(velocities_x);
+        __m128 vy = _mm_loadu_ps(velocities_y);
+        __m128 ax = _mm_setzero_ps();
+        __m128 ay = _mm_setzero_ps();
+
+        for (int j = 0; j < count; j++) {
+            const Attractor *a = &attractors[j];
+            const __m128 strength_v = _mm_set1_ps(a->strength);
+
+            __m128 dx = _mm_sub_ps(_mm_set1_ps(a->position.x), px);
+            __m128 dy = _mm_sub_ps(_mm_set1_ps(a->position.y), py);
+            __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            d2 = _mm_max_ps(d2, one_v);
+            __m128 d = _mm_sqrt_ps(d2);
+
+            __m128 mag;
+            if (a->falloff == _FALLOFF_LINEAR)
+                mag = _mm_div_ps(
+                    _mm_mul_ps(strength_v,
+                               _mm_sub_ps(one_v, _mm_div_ps(
+                                                     d, _mm_set1_ps(a->radius)))),
+                    d);
+            else
+                mag = _mm_div_ps(strength_v, _mm_mul_ps(d2, d));
+
+            __m128 inside = _mm_cmplt_ps(d2, _mm_set1_ps(a->radius * a->radius));
+
+            ax = _mm_add_ps(ax, _mm_and_ps(inside, _mm_mul_ps(dx, mag)));
+            ay = _mm_add_ps(ay, _mm_and_ps(inside, _mm_mul_ps(dy, mag)));
+        }
 
-        px = _mm_add_ps(px, _mm_mul_ps(vx, dt_v));
-        py = _mm_add_ps(py, _mm_mul_ps(vy, dt_v));
-        t = _mm_sub_ps(t, dt_v);
+        vx = _mm_add_ps(vx, _mm_mul_ps(ax, dt_v));
+        vy = _mm_add_ps(vy, _mm_mul_ps(ay, dt_v));
 
-        _mm_storeu_ps(positions_x, px);
-        _mm_storeu_ps(positions_y, py);
-        _mm_storeu_ps(lifetimes, t);
+        _mm_storeu_ps(velocities_x, vx);
+        _mm_storeu_ps(velocities_y, vy);
 
-        velocities_x += 4;
-        velocities_y += 4;
         positions_x += 4;
         positions_y += 4;
-        lifetimes += 4;
+        velocities_x += 4;
+        velocities_y += 4;
     }
 
     for (i = 0; i < n_excess; i++) {
-        positions_x[i] += velocities_x[i] * dt;
-        positions_y[i] += velocities_y[i] * dt;
-        lifetimes[i] -= dt;
+        float ax = 0.0f, ay = 0.0f;
+
+        for (int j = 0; j < count; j++) {
+            const Attractor *a = &attractors[j];
+            const float dx = a->position.x - positions_x[i];
+            const float dy = a->position.y - positions_y[i];
+            float d2 = dx * dx + dy * dy;
+            d2 = d2 > 1.0f ? d2 : 1.0f;
+            const float d = sqrtf(d2);
+
+            const float mag = a->falloff == _FALLOFF_LINEAR
+                                  ? a->strength * (1.0f - d / a->radius) / d
+                                  : a->strength / (d2 * d);
+
+            const bool inside = d2 < a->radius * a->radius;
+            ax += inside ? dx * mag : 0.0f;
+            ay += inside ? dy * mag : 0.0f;
+        }
+
+        velocities_x[i] += ax * dt;
+        velocities_y[i] += ay * dt;
     }
 }
 #else
 void
-update_with_no_acceleration_sse2(DataBlock *block, float dt)
+apply_attractors_sse2(DataBlock *block, const Attractor *attractors, int count,
+                      float dt)
 {
     BAD_SSE2_FUNCTION_CALL
 }
 #endif /* __SSE2__ || ENABLE_ARM_NEON */
 
 #if defined(__SSE2__) || defined(ENABLE_ARM_NEON)
+static FORCEINLINE __m128
+floor_sse2(__m128 x, __m128i *x_int)
+{
+    /* floor() without SSE4.1, truncate then step down for negatives */
+    __m128i xi = _mm_cvttps_epi32(x);
+    __m128 xf = _mm_cvtepi32_ps(xi);
+    __m128 gt = _mm_cmpgt_ps(xf, x);
+
+    *x_int = _mm_add_epi32(xi, _mm_castps_si128(gt));
+
+    return _mm_sub_ps(xf, _mm_and_ps(gt, _mm_set1_ps(1.0f)));
+}
+
+static FORCEINLINE __m128
+lerp_lattice_sse2(const float *lattice, const int *i00, const int *i10,
+                  const int *i01, const int *i11, __m128 tx, __m128 ty)
+{
+    /* SSE2 has no gathers, the four corners are loaded lane by lane */
+    __m128 c00 = _mm_set_ps(lattice[i00[3]], lattice[i00[2]], lattice[i00[1]],
+                            lattice[i00[0]]);
+    __m128 c10 = _mm_set_ps(lattice[i10[3]], lattice[i10[2]], lattice[i10[1]],
+                            lattice[i10[0]]);
+    __m128 c01 = _mm_set_ps(lattice[i01[3]], lattice[i01[2]], lattice[i01[1]],
+                            lattice[i01[0]]);
+    __m128 c11 = _mm_set_ps(lattice[i11[3]], lattice[i11[2]], lattice[i11[1]],
+                            lattice[i11[0]]);
+
+    __m128 top = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), tx));
+    __m128 bot = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), tx));
+
+    return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bot, top), ty));
+}
+
 void
-update_with_acceleration_x_sse2(DataBlock *block, float dt)
+apply_noise_sse2(DataBlock *block, float dt)
 {
     float *restrict positions_x = block->positions_x.data;
     float *restrict positions_y = block->positions_y.data;
-    float *restrict velocities_x = block->velocities_x.data;
-    float *restrict velocities_y = block->velocities_y.data;
-    float *restrict accelerations_x = block->accelerations_x.data;
-    float *restrict lifetimes = block->lifetimes.data;
 
     const int n_iters_4 = block->particles_count / 4;
     const int n_excess = block->particles_count % 4;
-    const __m128 dt_v = _mm_set1_ps(dt);
+    const float freq = block->noise.frequency;
+    const float offset = block->noise_offset;
+    const float scale = block->noise.strength * dt;
+    const __m128 freq_v = _mm_set1_ps(freq);
+    const __m128 offset_v = _mm_set1_ps(offset);
+    const __m128 scale_v = _mm_set1_ps(scale);
+    const __m128i mask_v = _mm_set1_epi32(NOISE_LATTICE_MASK);
+    const __m128i one_i = _mm_set1_epi32(1);
 
     int i;
 
     for (i = 0; i < n_iters_4; i++) {
-        __m128 ax = _mm_loadu_ps(accelerations_x);
-        __m128 vx = _mm_loadu_ps(velocities_x);
-        __m128 vy = _mm_loadu_ps(velocities_y);
         __m128 px = _mm_loadu_ps(positions_x);
         __m128 py = _mm_loadu_ps(positions_y);
-        __m128 t = _mm_loadu_ps(lifetimes);
 
-        vx = _mm_add_ps(vx, _mm_mul_ps(ax, dt_v));
-        px = _mm_add_ps(px, _mm_mul_ps(vx, dt_v));
-        py = _mm_add_ps(py, _mm_mul_ps(vy, dt_v));
-        t = _mm_sub_ps(t, dt_v);
+        __m128 u = _mm_mul_ps(px, freq_v);
+        __m128 v = _mm_add_ps(_mm_mul_ps(py, freq_v), offset_v);
+
+        __m128i iu, iv;
+        __m128 fu = floor_sse2(u, &iu);
+        __m128 fv = floor_sse2(v, &iv);
+
+        __m128 tx = _mm_sub_ps(u, fu);
+        __m128 ty = _mm_sub_ps(v, fv);
+
+        __m128i x0 = _mm_and_si128(iu, mask_v);
+        __m128i y0 = _mm_and_si128(iv, mask_v);
+        __m128i x1 = _mm_and_si128(_mm_add_epi32(x0, one_i), mask_v);
+        __m128i y1 = _mm_and_si128(_mm_add_epi32(y0, one_i), mask_v);
+        y0 = _mm_slli_epi32(y0, NOISE_LATTICE_BITS);
+        y1 = _mm_slli_epi32(y1, NOISE_LATTICE_BITS);
+
+        int i00[4], i10[4], i01[4], i11[4];
+        _mm_storeu_si128((__m128i *)i00, _mm_or_si128(y0, x0));
+        _mm_storeu_si128((__m128i *)i10, _mm_or_si128(y0, x1));
+        _mm_storeu_si128((__m128i *)i01, _mm_or_si128(y1, x0));
+        _mm_storeu_si128((__m128i *)i11, _mm_or_si128(y1, x1));
+
+        __m128 nx = lerp_lattice_sse2(curl_noise_x, i00, i10, i01, i11, tx, ty);
+        __m128 ny = lerp_lattice_sse2(curl_noise_y, i00, i10, i01, i11, tx, ty);
+
+        px = _mm_add_ps(px, _mm_mul_ps(nx, scale_v));
+        py = _mm_add_ps(py, _mm_mul_ps(ny, scale_v));
 
-        _mm_storeu_ps(velocities_x, vx);
         _mm_storeu_ps(positions_x, px);
         _mm_storeu_ps(positions_y, py);
-        _mm_storeu_ps(lifetimes, t);
 
-        accelerations_x += 4;
-        velocities_x += 4;
-        velocities_y += 4;
         positions_x += 4;
         positions_y += 4;
-        lifetimes += 4;
     }
 
     for (i = 0; i < n_excess; i++) {
-        velocities_x[i] += accelerations_x[i] * dt;
-        positions_x[i] += velocities_x[i] * dt;
-        positions_y[i] += velocities_y[i] * dt;
-        lifetimes[i] -= dt;
+        const float u = positions_x[i] * freq;
+        const float v = positions_y[i] * freq + offset;
+        const float fu = floorf(u);
+        const float fv = floorf(v);
+        const float tx = u - fu;
+        const float ty = v - fv;
+
+        const int x0 = (int)fu & NOISE_LATTICE_MASK;
+        const int y0 = (int)fv & NOISE_LATTICE_MASK;
+        const int x1 = (x0 + 1) & NOISE_LATTICE_MASK;
+        const int y1 = (y0 + 1) & NOISE_LATTICE_MASK;
+
+        const int i00 = (y0 << NOISE_LATTICE_BITS) | x0;
+        const int i10 = (y0 << NOISE_LATTICE_BITS) | x1;
+        const int i01 = (y1 << NOISE_LATTICE_BITS) | x0;
+        const int i11 = (y1 << NOISE_LATTICE_BITS) | x1;
+
+        float top = curl_noise_x[i00] + (curl_noise_x[i10] - curl_noise_x[i00]) * tx;
+        float bot = curl_noise_x[i01] + (curl_noise_x[i11] - curl_noise_x[i01]) * tx;
+        const float nx = top + (bot - top) * ty;
+
+        top = curl_noise_y[i00] + (curl_noise_y[i10] - curl_noise_y[i00]) * tx;
+        bot = curl_noise_y[i01] + (curl_noise_y[i11] - curl_noise_y[i01]) * tx;
+        const float ny = top + (bot - top) * ty;
+
+        positions_x[i] += nx * scale;
+        positions_y[i] += ny * scale;
     }
 }
 #else
 void
-update_with_acceleration_x_sse2(DataBlock *block, float dt)
+apply_noise_sse2(DataBlock *block, float dt)
 {
     BAD_SSE2_FUNCTION_CALL
 }
 #endif /* __SSE2__ || ENABLE_ARM_NEON */
 
 #if defined(__SSE2__) || defined(ENABLE_ARM_NEON)
-void
-update_with_acceleration_y_sse2(DataBlock *block, float dt)
+/* SSE2 has no blendv, select with and/andnot/or */
+#define SELECT_SSE2(mask, a, b) \
+    _mm_or_ps(_mm_and_ps((mask), (a)), _mm_andnot_ps((mask), (b)))
+
+static FORCEINLINE void
+bounce_axis_sse2(__m128 *p, __m128 *v_normal, __m128 *v_tangent, __m128 lo_v,
+                 __m128 hi_v, __m128 neg_restitution_v, __m128 keep_v)
+{
+    __m128 lo = _mm_cmplt_ps(*p, lo_v);
+    __m128 hi = _mm_cmpgt_ps(*p, hi_v);
+    __m128 hit = _mm_or_ps(lo, hi);
+
+    *p = SELECT_SSE2(lo, lo_v, *p);
+    *p = SELECT_SSE2(hi, hi_v, *p);
+    *v_normal = SELECT_SSE2(hit, _mm_mul_ps(*v_normal, neg_restitution_v), *v_normal);
+    *v_tangent = SELECT_SSE2(hit, _mm_mul_ps(*v_tangent, keep_v), *v_tangent);
+}
+
+int
+collide_bounds_sse2(DataBlock *block, const CollisionBounds *bounds)
 {
     float *restrict positions_x = block->positions_x.data;
     float *restrict positions_y = block->positions_y.data;
     float *restrict velocities_x = block->velocities_x.data;
     float *restrict velocities_y = block->velocities_y.data;
-    float *restrict accelerations_y = block->accelerations_y.data;
-    float *restrict lifetimes = block->lifetimes.data;
 
     const int n_iters_4 = block->particles_count / 4;
     const int n_excess = block->particles_count % 4;
-    const __m128 dt_v = _mm_set1_ps(dt);
+    const __m128 left_v = _mm_set1_ps(bounds->left);
+    const __m128 top_v = _mm_set1_ps(bounds->top);
+    const __m128 right_v = _mm_set1_ps(bounds->right);
+    const __m128 bottom_v = _mm_set1_ps(bounds->bottom);
 
     int i;
 
+    if (bounds->response == _COLLISION_KILL) {
+        for (i = 0; i < n_iters_4; i++) {
+            __m128 px = _mm_loadu_ps(positions_x);
+            __m128 py = _mm_loadu_ps(positions_y);
+
+            __m128 hit = _mm_or_ps(
+                _mm_or_ps(_mm_cmplt_ps(px, left_v), _mm_cmpgt_ps(px, right_v)),
+                _mm_or_ps(_mm_cmplt_ps(py, top_v), _mm_cmpgt_ps(py, bottom_v)));
+
+            const int hits = _mm_movemask_ps(hit);
+            if (hits)
+                return i * 4 + _first_lane(hits);
+
+            positions_x += 4;
+            positions_y += 4;
+        }
+
+        for (i = 0; i < n_excess; i++) {
+            if (positions_x[i] < bounds->left || positions_x[i] > bounds->right ||
+                positions_y[i] < bounds->top || positions_y[i] > bounds->bottom)
+                return n_iters_4 * 4 + i;
+        }
+
+        return -1;
+    }
+
+    const float neg_restitution = -bounds->restitution;
+    const float keep = 1.0f - bounds->friction;
+    const __m128 neg_restitution_v = _mm_set1_ps(neg_restitution);
+    const __m128 keep_v = _mm_set1_ps(keep);
+
     for (i = 0; i < n_iters_4; i++) {
-        __m128 ay = _mm_loadu_ps(accelerations_y);
-        __m128 vx = _mm_loadu_ps(velocities_x);
-        __m128 vy = _mm_loadu_ps(velocities_y);
         __m128 px = _mm_loadu_ps(positions_x);
         __m128 py = _mm_loadu_ps(positions_y);
-        __m128 t = _mm_loadu_ps(lifetimes);
+        __m128 vx = _mm_loadu_ps(velocities_x);
+        __m128 vy = _mm_loadu_ps(velocities_y);
 
-        vy = _mm_add_ps(vy, _mm_mul_ps(ay, dt_v));
-        px = _mm_add_ps(px, _mm_mul_ps(vx, dt_v));
-        py = _mm_add_ps(py, _mm_mul_ps(vy, dt_v));
-        t = _mm_sub_ps(t, dt_v);
+        bounce_axis_sse2(&px, &vx, &vy, left_v, right_v, neg_restitution_v, keep_v);
+        bounce_axis_sse2(&py, &vy, &vx, top_v, bottom_v, neg_restitution_v, keep_v);
 
-        _mm_storeu_ps(velocities_y, vy);
         _mm_storeu_ps(positions_x, px);
         _mm_storeu_ps(positions_y, py);
-        _mm_storeu_ps(lifetimes, t);
+        _mm_storeu_ps(velocities_x, vx);
+        _mm_storeu_ps(velocities_y, vy);
 
-        accelerations_y += 4;
-        velocities_x += 4;
-        velocities_y += 4;
         positions_x += 4;
         positions_y += 4;
-        lifetimes += 4;
+        velocities_x += 4;
+        velocities_y += 4;
     }
 
     for (i = 0; i < n_excess; i++) {
-        velocities_y[i] += accelerations_y[i] * dt;
-        positions_x[i] += velocities_x[i] * dt;
-        positions_y[i] += velocities_y[i] * dt;
-        lifetimes[i] -= dt;
+        float px = positions_x[i];
+        float py = positions_y[i];
+        float vx = velocities_x[i];
+        float vy = velocities_y[i];
+
+        bool lo = px < bounds->left;
+        bool hi = px > bounds->right;
+        px = lo ? bounds->left : px;
+        px = hi ? bounds->right : px;
+        vx = lo || hi ? vx * neg_restitution : vx;
+        vy = lo || hi ? vy * keep : vy;
+
+        lo = py < bounds->top;
+        hi = py > bounds->bottom;
+        py = lo ? bounds->top : py;
+        py = hi ? bounds->bottom : py;
+        vy = lo || hi ? vy * neg_restitution : vy;
+        vx = lo || hi ? vx * keep : vx;
+
+        positions_x[i] = px;
+        positions_y[i] = py;
+        velocities_x[i] = vx;
+        velocities_y[i] = vy;
     }
+
+    return -1;
 }
+
+#undef SELECT_SSE2
 #else
-void
-update_with_acceleration_y_sse2(DataBlock *block, float dt)
+int
+collide_bounds_sse2(DataBlock *block, const CollisionBounds *bounds)
 {
     BAD_SSE2_FUNCTION_CALL
+    return -1;
 }
 #endif /* __SSE2__ || ENABLE_ARM_NEON */
 
 #if defined(__SSE2__) || defined(ENABLE_ARM_NEON)
-void
-update_indices_sse2(DataBlock *block)
+static FORCEINLINE __m128
+grid_cell_solid_sse2(const OccupancyGrid *grid, __m128 x, __m128 y, __m128 inv_v)
+{
+    __m128i cx, cy;
+    floor_sse2(_mm_mul_ps(x, inv_v), &cx);
+    floor_sse2(_mm_mul_ps(y, inv_v), &cy);
+
+    int cxs[4], cys[4];
+    _mm_storeu_si128((__m128i *)cxs, cx);
+    _mm_storeu_si128((__m128i *)cys, cy);
+
+    /* SSE2 has no gathers, each lane is looked up on its own */
+    int solid[4];
+    for (int k = 0; k < 4; k++) {
+        const bool inside = cxs[k] >= 0 && cxs[k] < grid->width && cys[k] >= 0 &&
+                            cys[k] < grid->height;
+        solid[k] = inside && grid->cells[cys[k] * grid->width + cxs[k]] ? -1 : 0;
+    }
+
+    return _mm_castsi128_ps(_mm_loadu_si128((__m128i *)solid));
+}
+
+int
+collide_grid_sse2(DataBlock *block, const OccupancyGrid *grid, float dt)
 {
-    float *restrict lifetimes = block->lifetimes.data;
-    float *restrict max_lifetimes = block->max_lifetimes.data;
-    __m128i *indices128p = (__m128i *)block->animation_indices;
+    float *restrict positions_x = block->positions_x.data;
+    float *restrict positions_y = block->positions_y.data;
+    float *restrict velocities_x = block->velocities_x.data;
+    float *restrict velocities_y = block->velocities_y.data;
 
     const int n_iters_4 = block->particles_count / 4;
     const int n_excess = block->particles_count % 4;
-    const __m128 one_v = _mm_set1_ps(1.0f);
-    const __m128 num_frames_v = _mm_set1_ps((float)(block->num_frames));
+    const __m128 inv_v = _mm_set1_ps(grid->inv_cell_size);
 
     int i;
 
-    for (i = 0; i < n_iters_4; i++) {
-        __m128 t = _mm_loadu_ps(lifetimes);
-        __m128 max_t = _mm_loadu_ps(max_lifetimes);
+    if (grid->response == _COLLISION_KILL) {
+        for (i = 0; i < n_iters_4; i++) {
+            __m128 px = _mm_loadu_ps(positions_x);
+            __m128 py = _mm_loadu_ps(positions_y);
+
+            const int hits = _mm_movemask_ps(grid_cell_solid_sse2(grid, px, py, inv_v));
+            if (hits)
+                return i * 4 + _first_lane(hits);
 
-        __m128i idx = _mm_cvttps_epi32(
-            _mm_mul_ps(_mm_sub_ps(one_v, _mm_div_ps(t, max_t)), num_frames_v));
+            positions_x += 4;
+            positions_y += 4;
+        }
 
-        _mm_storeu_si128(indices128p, idx);
+        for (i = 0; i < n_excess; i++) {
+            if (grid_cell_solid(grid, positions_x[i], positions_y[i]))
+                return n_iters_4 * 4 + i;
+        }
 
-        lifetimes += 4;
-        max_lifetimes += 4;
-        indices128p++;
+        return -1;
     }
 
-    int *indices = (int *)indices128p;
+    const float neg_restitution = -grid->restitution;
+    const __m128 dt_v = _mm_set1_ps(dt);
+    const __m128 neg_restitution_v = _mm_set1_ps(neg_restitution);
 
-    for (i = 0; i < n_excess; i++) {
-        __m128 t = _mm_load_ss(lifetimes);
-        __m128 max_t = _mm_load_ss(max_lifetimes);
+    for (i = 0; i < n_iters_4; i++) {
+        __m128 px = _mm_loadu_ps(positions_x);
+        __m128 py = _mm_loadu_ps(positions_y);
+        __m128 vx = _mm_loadu_ps(velocities_x);
+        __m128 vy = _mm_loadu_ps(velocities_y);
+        __m128 ox = _mm_sub_ps(px, _mm_mul_ps(vx, dt_v));
+        __m128 oy = _mm_sub_ps(py, _mm_mul_ps(vy, dt_v));
+
+        __m128 hit = grid_cell_solid_sse2(grid, px, py, inv_v);
+        __m128 hit_x = grid_cell_solid_sse2(grid, px, oy, inv_v);
+        __m128 hit_y = grid_cell_solid_sse2(grid, ox, py, inv_v);
+        __m128 corner = _mm_andnot_ps(_mm_or_ps(hit_x, hit_y),
+                                      _mm_castsi128_ps(_mm_set1_epi32(-1)));
+        __m128 flip_x = _mm_and_ps(hit, _mm_or_ps(hit_x, corner));
+        __m128 flip_y = _mm_and_ps(hit, _mm_or_ps(hit_y, corner));
+
+        px = _mm_or_ps(_mm_and_ps(flip_x, ox), _mm_andnot_ps(flip_x, px));
+        py = _mm_or_ps(_mm_and_ps(flip_y, oy), _mm_andnot_ps(flip_y, py));
+        vx = _mm_or_ps(_mm_and_ps(flip_x, _mm_mul_ps(vx, neg_restitution_v)),
+                       _mm_andnot_ps(flip_x, vx));
+        vy = _mm_or_ps(_mm_and_ps(flip_y, _mm_mul_ps(vy, neg_restitution_v)),
+                       _mm_andnot_ps(flip_y, vy));
 
-        __m128i idx = _mm_cvttps_epi32(
-            _mm_mul_ss(_mm_sub_ss(one_v, _mm_div_ss(t, max_t)), num_frames_v));
+        _mm_storeu_ps(positions_x, px);
+        _mm_storeu_ps(positions_y, py);
+        _mm_storeu_ps(velocities_x, vx);
+        _mm_storeu_ps(velocities_y, vy);
+
+        positions_x += 4;
+        positions_y += 4;
+        velocities_x += 4;
+        velocities_y += 4;
+    }
 
-        indices[i] = _mm_cvtsi128_si32(idx);
+    for (i = 0; i < n_excess; i++) {
+        const float px = positions_x[i];
+        const float py = positions_y[i];
+        const float vx = velocities_x[i];
+        const float vy = velocities_y[i];
+        const float ox = px - vx * dt;
+        const float oy = py - vy * dt;
+
+        const bool hit = grid_cell_solid(grid, px, py);
+        const bool hit_x = grid_cell_solid(grid, px, oy);
+        const bool hit_y = grid_cell_solid(grid, ox, py);
+        const bool corner = !hit_x && !hit_y;
+        const bool flip_x = hit && (hit_x || corner);
+        const bool flip_y = hit && (hit_y || corner);
+
+        positions_x[i] = flip_x ? ox : px;
+        positions_y[i] = flip_y ? oy : py;
+        velocities_x[i] = flip_x ? vx * neg_restitution : vx;
+        velocities_y[i] = flip_y ? vy * neg_restitution : vy;
     }
+
+    return -1;
 }
 #else
-void
-update_indices_sse2(DataBlock *block)
+int
+collide_grid_sse2(DataBlock *block, const OccupancyGrid *grid, float dt)
 {
     BAD_SSE2_FUNCTION_CALL
+    return -1;
 }
 #endif /* __SSE2__ || ENABLE_ARM_NEON */
 
@@ -449,91 +747,156 @@ void inline blit_add_sse2_5x5(uint32_t *srcp32, uint32_t *dstp32, int src_skip,
     *dstp32 = _mm_cvtsi128_si32(dst128);
 }
 
+/* Adds one sprite of the atlas, dst_pitch is in pixels */
 void
-blit_fragments_add_sse2(FragmentationMap *frag_map, PyObject **animation,
-                        int dst_skip)
+blit_sprite_add_sse2(const SpriteAtlas *atlas, const uint32_t *src, uint32_t *dst,
+                     int width, int rows, int dst_pitch)
 {
-    Fragment *fragments = frag_map->fragments;
-    BlitDestination *destinations = frag_map->destinations;
-
-    for (int i = 0; i < frag_map->used_f; i++) {
-        Fragment *fragment = &fragments[i];
-        SDL_Surface *src_surf =
-            ((pgSurfaceObject *)animation[fragment->animation_index])->surf;
-        uint32_t *const src_start = (uint32_t *)src_surf->pixels;
-
-        for (int j = 0; j < fragment->length; j++) {
-            BlitDestination *item = &destinations[j];
-
-            uint32_t *srcp32 = src_start + item->src_offset;
-            uint32_t *dstp32 = item->pixels;
-            const int src_skip = src_surf->pitch / 4 - item->width;
-            const int actual_dst_skip = dst_skip - item->width;
-
-            if (item->width == 1 && item->rows == 1) {
-                blit_add_sse2_1x1(srcp32, dstp32);
-                continue;
-            }
-            else if (item->width == 2 && item->rows == 2) {
-                blit_add_sse2_2x2(srcp32, dstp32, src_skip, actual_dst_skip);
-                continue;
-            }
-            else if (item->width == 3 && item->rows == 3) {
-                blit_add_sse2_3x3(srcp32, dstp32, src_skip, actual_dst_skip);
-                continue;
-            }
-            else if (item->width == 4 && item->rows == 4) {
-                blit_add_sse2_4x4(srcp32, dstp32, src_skip, actual_dst_skip);
-                continue;
-            }
-            else if (item->width == 5 && item->rows == 5) {
-                blit_add_sse2_5x5(srcp32, dstp32, src_skip, actual_dst_skip);
-                continue;
-            }
-
-            int h = item->rows;
-            const int n_iters_4 = item->width / 4;
-            const int pxl_excess = item->width % 4;
-            int k;
-
-            while (h--) {
-                for (k = 0; k < n_iters_4; k++) {
-                    __m128i src128 = _mm_loadu_si128((__m128i *)srcp32);
-                    __m128i dst128 = _mm_loadu_si128((__m128i *)dstp32);
-
-                    dst128 = _mm_adds_epu8(src128, dst128);
-
-                    _mm_storeu_si128((__m128i *)dstp32, dst128);
-
-                    srcp32 += 4;
-                    dstp32 += 4;
-                }
-
-                for (k = 0; k < pxl_excess; k++) {
-                    __m128i src128 = _mm_cvtsi32_si128(*srcp32);
-                    __m128i dst128 = _mm_cvtsi32_si128(*dstp32);
-
-                    dst128 = _mm_adds_epu8(src128, dst128);
-
-                    *dstp32 = _mm_cvtsi128_si32(dst128);
-
-                    srcp32++;
-                    dstp32++;
-                }
-
-                srcp32 += src_skip;
-                dstp32 += actual_dst_skip;
-            }
+    uint32_t *srcp32 = (uint32_t *)src;
+    uint32_t *dstp32 = dst;
+    const int src_skip = atlas->pitch - width;
+    const int actual_dst_skip = dst_pitch - width;
+
+    if (width == 1 && rows == 1) {
+        blit_add_sse2_1x1(srcp32, dstp32);
+        return;
+    }
+    else if (width == 2 && rows == 2) {
+        blit_add_sse2_2x2(srcp32, dstp32, src_skip, actual_dst_skip);
+        return;
+    }
+    else if (width == 3 && rows == 3) {
+        blit_add_sse2_3x3(srcp32, dstp32, src_skip, actual_dst_skip);
+        return;
+    }
+    else if (width == 4 && rows == 4) {
+        blit_add_sse2_4x4(srcp32, dstp32, src_skip, actual_dst_skip);
+        return;
+    }
+    else if (width == 5 && rows == 5) {
+        blit_add_sse2_5x5(srcp32, dstp32, src_skip, actual_dst_skip);
+        return;
+    }
+
+    int h = rows;
+    const int n_iters_4 = width / 4;
+    const int pxl_excess = width % 4;
+    int k;
+
+    while (h--) {
+        for (k = 0; k < n_iters_4; k++) {
+            __m128i src128 = _mm_loadu_si128((__m128i *)srcp32);
+            __m128i dst128 = _mm_loadu_si128((__m128i *)dstp32);
+
+            dst128 = _mm_adds_epu8(src128, dst128);
+
+            _mm_storeu_si128((__m128i *)dstp32, dst128);
+
+            srcp32 += 4;
+            dstp32 += 4;
         }
 
-        destinations += fragment->length;
+        for (k = 0; k < pxl_excess; k++) {
+            __m128i src128 = _mm_cvtsi32_si128(*srcp32);
+            __m128i dst128 = _mm_cvtsi32_si128(*dstp32);
+
+            dst128 = _mm_adds_epu8(src128, dst128);
+
+            *dstp32 = _mm_cvtsi128_si32(dst128);
+
+            srcp32++;
+            dstp32++;
+        }
+
+        srcp32 += src_skip;
+        dstp32 += actual_dst_skip;
+    }
+}
+
+void
+blit_fragments_add_sse2(FragmentationMap *frag_map, const SpriteAtlas *atlas,
+                        int dst_skip)
+{
+    const BlitDestination *destinations = frag_map->destinations;
+
+    for (int i = 0; i < frag_map->dest_count; i++) {
+        const BlitDestination *item = &destinations[i];
+        blit_sprite_add_sse2(atlas, item->src, item->pixels, item->width, item->rows,
+                             dst_skip);
+    }
+}
+
+/* Four pixels at a time. Their offsets come out of one multiply-add with the
+ * row in the low and the column in the high 16 bits of each lane, which is
+ * where the fixed point x already keeps it */
+void
+draw_streak_add_sse2(const SpriteAtlas *atlas, const Streak *streak, uint32_t *pixels,
+                     int pitch)
+{
+    const int32_t sx = streak->step_x, sy = streak->step_y;
+    const __m128i color = _mm_set1_epi32((int)streak->color);
+    const __m128i row_column = _mm_set1_epi32((1 << 16) | pitch);
+    const __m128i column_mask = _mm_set1_epi32((int)0xFFFF0000);
+    const __m128i step4_x = _mm_set1_epi32(4 * sx);
+    const __m128i step4_y = _mm_set1_epi32(4 * sy);
+
+    __m128i xs = _mm_add_epi32(_mm_set1_epi32(streak->x),
+                               _mm_set_epi32(3 * sx, 2 * sx, sx, 0));
+    __m128i ys = _mm_add_epi32(_mm_set1_epi32(streak->y),
+                               _mm_set_epi32(3 * sy, 2 * sy, sy, 0));
+
+    int32_t offsets[4];
+    uint32_t values[4];
+    int k = 0;
+
+    for (; k + 4 <= streak->count; k += 4) {
+        const __m128i cells =
+            _mm_or_si128(_mm_srli_epi32(ys, 16), _mm_and_si128(xs, column_mask));
+        _mm_storeu_si128((__m128i *)offsets, _mm_madd_epi16(cells, row_column));
+
+        __m128i dst128 = _mm_set_epi32(pixels[offsets[3]], pixels[offsets[2]],
+                                       pixels[offsets[1]], pixels[offsets[0]]);
+        dst128 = _mm_adds_epu8(dst128, color);
+        _mm_storeu_si128((__m128i *)values, dst128);
+
+        pixels[offsets[0]] = values[0];
+        pixels[offsets[1]] = values[1];
+        pixels[offsets[2]] = values[2];
+        pixels[offsets[3]] = values[3];
+
+        xs = _mm_add_epi32(xs, step4_x);
+        ys = _mm_add_epi32(ys, step4_y);
+    }
+
+    int32_t x = streak->x + k * sx, y = streak->y + k * sy;
+
+    for (; k < streak->count; k++) {
+        uint32_t *dstp32 = pixels + (y >> 16) * pitch + (x >> 16);
+        *dstp32 = _mm_cvtsi128_si32(_mm_adds_epu8(_mm_cvtsi32_si128(*dstp32), color));
+
+        x += sx;
+        y += sy;
     }
 }
 #else
 void
-blit_fragments_add_sse2(FragmentationMap *frag_map, PyObject **animation,
+blit_sprite_add_sse2(const SpriteAtlas *atlas, const uint32_t *src, uint32_t *dst,
+                     int width, int rows, int dst_pitch)
+{
+    BAD_SSE2_FUNCTION_CALL
+}
+
+void
+blit_fragments_add_sse2(FragmentationMap *frag_map, const SpriteAtlas *atlas,
                         int dst_skip)
 {
     BAD_SSE2_FUNCTION_CALL
 }
+
+void
+draw_streak_add_sse2(const SpriteAtlas *atlas, const Streak *streak, uint32_t *pixels,
+                     int pitch)
+{
+    BAD_SSE2_FUNCTION_CALL
+}
 #endif /* __SSE2__ || ENABLE_ARM_NEON */
@@ -0,0 +1,133 @@
+#include "include/worker_pool.h"
+
+static void
+run_jobs(WorkerPool *pool)
+{
+    for (;;) {
+        const int index = SDL_AtomicAdd(&pool->next, 1);
+        if (index >= pool->num_jobs)
+            return;
+
+        pool->job(pool->arg, index);
+    }
+}
+
+static int
+worker_main(void *data)
+{
+    WorkerPool *pool = data;
+    unsigned int seen = 0;
+
+    SDL_LockMutex(pool->lock);
+
+    for (;;) {
+        while (pool->generation == seen && !pool->quit)
+            SDL_CondWait(pool->wake, pool->lock);
+
+        if (pool->quit)
+            break;
+
+        seen = pool->generation;
+        SDL_UnlockMutex(pool->lock);
+
+        run_jobs(pool);
+
+        SDL_LockMutex(pool->lock);
+        if (--pool->busy == 0)
+            SDL_CondSignal(pool->done);
+    }
+
+    SDL_UnlockMutex(pool->lock);
+
+    return 0;
+}
+
+int
+worker_pool_init(WorkerPool *pool, int num_threads)
+{
+    memset(pool, 0, sizeof(WorkerPool));
+
+    if (!num_threads)
+        return 1;
+
+    pool->threads = PyMem_New(SDL_Thread *, num_threads);
+    if (!pool->threads) {
+        PyErr_NoMemory();
+        return 0;
+    }
+
+    pool->lock = SDL_CreateMutex();
+    pool->wake = SDL_CreateCond();
+    pool->done = SDL_CreateCond();
+    if (!pool->lock || !pool->wake || !pool->done)
+        goto on_error;
+
+    for (int i = 0; i < num_threads; i++) {
+        pool->threads[i] = SDL_CreateThread(worker_main, "pm_worker", pool);
+        if (!pool->threads[i])
+            goto on_error;
+
+        pool->num_threads++;
+    }
+
+    return 1;
+
+on_error:
+    PyErr_Format(PyExc_RuntimeError, "Could not start the worker threads: %s",
+                 SDL_GetError());
+    worker_pool_free(pool);
+    return 0;
+}
+
+void
+worker_pool_run(WorkerPool *pool, WorkerJob job, void *arg, int num_jobs)
+{
+    /* Waking the workers isn't worth it for a single job */
+    if (!pool->num_threads || num_jobs <= 1) {
+        for (int i = 0; i < num_jobs; i++)
+            job(arg, i);
+        return;
+    }
+
+    SDL_LockMutex(pool->lock);
+    pool->job = job;
+    pool->arg = arg;
+    pool->num_jobs = num_jobs;
+    SDL_AtomicSet(&pool->next, 0);
+    pool->busy = pool->num_threads;
+    pool->generation++;
+    SDL_CondBroadcast(pool->wake);
+    SDL_UnlockMutex(pool->lock);
+
+    run_jobs(pool);
+
+    /* A worker may still be running the last job it claimed */
+    SDL_LockMutex(pool->lock);
+    while (pool->busy)
+        SDL_CondWait(pool->done, pool->lock);
+    SDL_UnlockMutex(pool->lock);
+}
+
+void
+worker_pool_free(WorkerPool *pool)
+{
+    if (pool->lock) {
+        SDL_LockMutex(pool->lock);
+        pool->quit = true;
+        SDL_CondBroadcast(pool->wake);
+        SDL_UnlockMutex(pool->lock);
+    }
+
+    for (int i = 0; i < pool->num_threads; i++)
+        SDL_WaitThread(pool->threads[i], NULL);
+
+    if (pool->done)
+        SDL_DestroyCond(pool->done);
+    if (pool->wake)
+        SDL_DestroyCond(pool->wake);
+    if (pool->lock)
+        SDL_DestroyMutex(pool->lock);
+
+    PyMem_Free(pool->threads);
+    memset(pool, 0, sizeof(WorkerPool));
+}
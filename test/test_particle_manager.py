@@ -1,11 +1,916 @@
+import contextlib
+import json
+import os
+import tempfile
 import unittest
-from itz_particle_manager import ParticleManager
+
+import pygame
+from itz_particle_manager import (
+    COLLISION_BOUNCE,
+    COLLISION_KILL,
+    EMIT_POINT,
+    FALLOFF_LINEAR,
+    SIMD_AVX2,
+    SIMD_NONE,
+    SIMD_SSE2,
+    Emitter,
+    ParticleEffect,
+    ParticleManager,
+    ParticleSystem,
+    get_simd_level,
+    set_simd_level,
+)
+
+
+@contextlib.contextmanager
+def simd_level(level):
+    # restores whatever level was set before, not the default
+    previous = get_simd_level()
+    set_simd_level(level)
+    try:
+        yield
+    finally:
+        set_simd_level(previous)
+
+
+def render_seeded(seed, level, effect_seed=None):
+    with simd_level(level):
+        imgs = tuple(pygame.Surface((s, s)) for s in range(4, 0, -1))
+        for i, img in enumerate(imgs):
+            img.fill((40 * i + 20, 30, 200 - 40 * i))
+
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=203,
+            animation=imgs,
+            particle_lifetime=(20, 60),
+            speed_x=(-3, 3),
+            speed_y=(-3, 3),
+            acceleration_y=(0.01, 0.05),
+            noise_strength=0.5,
+        )
+        effect = ParticleEffect((emitter,), bounds=(0, 0, 160, 160), seed=effect_seed)
+
+        pm = ParticleManager(seed=seed)
+        pm.add_attractor((80, 80), 40.0, 60.0)
+        pm.spawn_effect(effect, (80, 80))
+        pm.spawn_effect(effect, (40, 100))
+
+        surf = pygame.Surface((160, 160))
+        for _ in range(30):
+            pm.update(1.0)
+        pm.draw(surf)
+
+        return pygame.image.tobytes(surf, "RGB")
 
 
 class TestParticleManager(unittest.TestCase):
     def test_init(self):
         pm = ParticleManager()
 
+    def test_add_attractor(self):
+        pm = ParticleManager()
+        pm.add_attractor((100, 100), 5.0, 50.0)
+        pm.add_attractor((0, 0), -2.0, 10.0, FALLOFF_LINEAR)
+        pm.clear_attractors()
+
+        with self.assertRaises(ValueError):
+            pm.add_attractor((0, 0), 1.0, 0.0)
+
+        with self.assertRaises(ValueError):
+            pm.add_attractor((0, 0), 1.0, 10.0, 42)
+
+        pm.max_attractors = 2
+        self.assertEqual(pm.max_attractors, 2)
+
+    def test_attractor_motion(self):
+        img = pygame.Surface((1, 1))
+        img.fill((255, 255, 255))
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=1,
+            animation=(img,),
+            particle_lifetime=100,
+        )
+
+        def column_after(strength):
+            pm = ParticleManager()
+            pm.spawn_effect(ParticleEffect((emitter,)), (30, 50))
+
+            # the particle spawns at rest and only meets the force later on
+            pm.update(1.0)
+            pm.add_attractor((50, 50), strength, 100.0)
+            for _ in range(3):
+                pm.update(1.0)
+
+            surf = pygame.Surface((100, 100))
+            pm.draw(surf)
+            row = [surf.get_at((x, 50)) for x in range(100)]
+            return row.index(pygame.Color(255, 255, 255))
+
+        pulled = column_after(400.0)
+        self.assertGreater(pulled, 30)
+        self.assertLess(pulled, 50)
+        self.assertLess(column_after(-400.0), 30)
+
+    def test_seeded_determinism(self):
+        reference = render_seeded(1234, SIMD_NONE)
+
+        self.assertEqual(render_seeded(1234, SIMD_NONE), reference)
+        self.assertEqual(render_seeded(1234, SIMD_SSE2), reference)
+        self.assertEqual(render_seeded(1234, SIMD_AVX2), reference)
+        self.assertNotEqual(render_seeded(4321, SIMD_NONE), reference)
+
+        # seeded effects don't depend on the manager's stream
+        self.assertEqual(
+            render_seeded(1, SIMD_AVX2, effect_seed=7),
+            render_seeded(2, SIMD_NONE, effect_seed=7),
+        )
+
+        # unseeded managers created back to back still get their own streams
+        self.assertNotEqual(
+            render_seeded(None, SIMD_AVX2), render_seeded(None, SIMD_AVX2)
+        )
+
+        with self.assertRaises(TypeError):
+            ParticleManager(seed=1.5)
+
+        with simd_level(SIMD_SSE2):
+            with simd_level(SIMD_NONE):
+                self.assertEqual(get_simd_level(), SIMD_NONE)
+            self.assertEqual(get_simd_level(), SIMD_SSE2)
+
+        with self.assertRaises(ValueError):
+            set_simd_level(42)
+
+    def test_animation_snapshot(self):
+        img = pygame.Surface((3, 3))
+        img.fill((255, 0, 0))
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=1,
+            animation=(img,),
+            particle_lifetime=100,
+            blend_mode=0,
+        )
+
+        # frames are packed when the Emitter is built, later edits don't show
+        img.fill((0, 0, 255))
+
+        pm = ParticleManager()
+        pm.spawn_effect(ParticleEffect((emitter,)), (10, 10))
+
+        surf = pygame.Surface((20, 20))
+        pm.draw(surf)
+
+        self.assertEqual(surf.get_at((11, 11)), pygame.Color(255, 0, 0))
+
+    def test_clipped_sprites(self):
+        img = pygame.Surface((4, 3))
+        for y in range(3):
+            for x in range(4):
+                img.set_at((x, y), (40 * x + 20, 60 * y + 30, 90))
+
+        # across every edge and corner of the clip rect, and fully inside
+        positions = [(x, y) for x in (-3, 2, 8, 13) for y in (-2, 4, 10)]
+
+        for blend_mode, flags in ((0, 0), (pygame.BLEND_ADD, pygame.BLEND_ADD)):
+            emitter = Emitter(
+                emit_shape=EMIT_POINT,
+                emit_number=1,
+                animation=(img,),
+                particle_lifetime=100,
+                blend_mode=blend_mode,
+            )
+            effect = ParticleEffect((emitter,))
+
+            pm = ParticleManager()
+            for pos in positions:
+                pm.spawn_effect(effect, pos)
+
+            surf = pygame.Surface((20, 16))
+            surf.fill((10, 20, 30))
+            surf.set_clip((1, 2, 14, 10))
+            pm.draw(surf)
+
+            # streamed blits clip like pygame's own blit
+            expected = pygame.Surface((20, 16))
+            expected.fill((10, 20, 30))
+            expected.set_clip((1, 2, 14, 10))
+            for pos in positions:
+                expected.blit(img, pos, special_flags=flags)
+
+            self.assertEqual(
+                pygame.image.tobytes(surf, "RGB"),
+                pygame.image.tobytes(expected, "RGB"),
+            )
+
+    def test_compact_emitter(self):
+        img = pygame.Surface((2, 2))
+        img.fill((255, 255, 255))
+
+        def render(compact, level, acceleration):
+            with simd_level(level):
+                emitter = Emitter(
+                    emit_shape=EMIT_POINT,
+                    emit_number=61,
+                    animation=(img,),
+                    particle_lifetime=(40, 80),
+                    speed_x=(-2, 2),
+                    speed_y=(-2, 2),
+                    acceleration_x=acceleration,
+                    acceleration_y=acceleration,
+                    compact=compact,
+                )
+                pm = ParticleManager(seed=99)
+                pm.spawn_effect(ParticleEffect((emitter,)), (50, 50))
+
+                surf = pygame.Surface((100, 100))
+                for _ in range(20):
+                    pm.update(1.0)
+                pm.draw(surf)
+
+                return pygame.image.tobytes(surf, "RGB")
+
+        reference = render(True, SIMD_NONE, (-0.1, 0.1))
+        self.assertEqual(render(True, SIMD_SSE2, (-0.1, 0.1)), reference)
+        self.assertEqual(render(True, SIMD_AVX2, (-0.1, 0.1)), reference)
+
+        # half floats hold 0.125 exactly, so nothing is lost to the rounding
+        self.assertEqual(
+            render(True, SIMD_AVX2, 0.125), render(False, SIMD_AVX2, 0.125)
+        )
+
+    def test_analytic_emitter(self):
+        img = pygame.Surface((2, 2))
+        img.fill((255, 255, 255))
+
+        def render(analytic, attract=False):
+            emitter = Emitter(
+                emit_shape=EMIT_POINT,
+                emit_number=30,
+                animation=(img,),
+                particle_lifetime=(40, 80),
+                speed_x=1.5,
+                speed_y=-0.75,
+                analytic=analytic,
+            )
+            pm = ParticleManager(seed=5)
+            pm.spawn_effect(ParticleEffect((emitter,)), (20, 60))
+
+            # the speeds are exact in binary, so stepping and the closed form
+            # land on the same positions
+            surf = pygame.Surface((100, 100))
+            for i in range(20):
+                if attract and i == 10:
+                    pm.add_attractor((50, 50), 1.0, 30.0)
+                pm.update(0.5)
+            pm.draw(surf)
+
+            return pygame.image.tobytes(surf, "RGB")
+
+        self.assertEqual(render(True), render(False))
+        self.assertEqual(render(True, attract=True), render(False, attract=True))
+
+        dot = pygame.Surface((1, 1))
+        dot.fill((255, 255, 255))
+
+        def row_after(analytic, dt, steps):
+            emitter = Emitter(
+                emit_shape=EMIT_POINT,
+                emit_number=1,
+                animation=(dot,),
+                particle_lifetime=100,
+                acceleration_y=1,
+                analytic=analytic,
+            )
+            pm = ParticleManager()
+            pm.spawn_effect(ParticleEffect((emitter,)), (10, 20))
+            for _ in range(steps):
+                pm.update(dt)
+
+            surf = pygame.Surface((20, 100))
+            pm.draw(surf)
+            column = [surf.get_at((10, y)) for y in range(100)]
+            return column.index(pygame.Color(255, 255, 255))
+
+        # under acceleration the closed form is exact, while stepping runs
+        # a * t * dt / 2 ahead of it: 5 pixels at dt = 1, 1.25 at dt = 0.25
+        self.assertEqual(row_after(True, 1.0, 10), 70)
+        self.assertEqual(row_after(False, 1.0, 10), 75)
+        self.assertEqual(row_after(True, 0.25, 40), 70)
+        self.assertEqual(row_after(False, 0.25, 40), 71)
+
+    def test_fixed_timestep(self):
+        img = pygame.Surface((2, 2))
+        img.fill((255, 255, 255))
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=30,
+            animation=(img,),
+            particle_lifetime=10,
+            speed_x=1.5,
+            speed_y=-0.75,
+        )
+
+        def render(fixed_timestep, steps):
+            pm = ParticleManager()
+            pm.fixed_timestep = fixed_timestep
+            pm.spawn_effect(ParticleEffect((emitter,)), (20, 60))
+            for dt in steps:
+                pm.update(dt)
+
+            surf = pygame.Surface((100, 100))
+            pm.draw(surf)
+
+            return pygame.image.tobytes(surf, "RGB")
+
+        self.assertEqual(render(0.5, (1.0,)), render(0, (0.5, 0.5)))
+
+        # the leftover quarter isn't simulated yet but is drawn ahead
+        self.assertEqual(render(0.5, (1.25,)), render(0, (0.5, 0.5, 0.25)))
+
+        # a hitch runs at most 8 substeps, the particles outlive it
+        pm = ParticleManager()
+        pm.fixed_timestep = 0.5
+        self.assertEqual(pm.fixed_timestep, 0.5)
+        pm.spawn_effect(ParticleEffect((emitter,)), (20, 60))
+        pm.update(100.0)
+        self.assertEqual(pm.num_particles, 30)
+
+        with self.assertRaises(ValueError):
+            pm.fixed_timestep = -1.0
+
+    def test_fixed_timestep_acceleration(self):
+        img = pygame.Surface((1, 1))
+        img.fill((255, 255, 255))
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=1,
+            animation=(img,),
+            particle_lifetime=100,
+            acceleration_y=4,
+            blend_mode=0,
+        )
+
+        pm = ParticleManager()
+        pm.fixed_timestep = 1.0
+        pm.spawn_effect(ParticleEffect((emitter,)), (5, 10))
+
+        surf = pygame.Surface((10, 120))
+        rows = []
+        for _ in range(24):
+            surf.fill((0, 0, 0))
+            pm.draw(surf)
+            rows.append(
+                next(y for y in range(120) if surf.get_at((5, y)).r == 255)
+            )
+            pm.update(0.25)
+
+        # drawn in between substeps the particle keeps accelerating smoothly,
+        # it doesn't jump when the next substep runs
+        deltas = [b - a for a, b in zip(rows, rows[1:])]
+        self.assertTrue(all(d >= 0 for d in deltas))
+        self.assertTrue(all(abs(b - a) <= 1 for a, b in zip(deltas, deltas[1:])))
+
+        # a leftover drawn ahead is where a real step that long would be
+        def render(fixed_timestep, steps):
+            pm = ParticleManager()
+            pm.fixed_timestep = fixed_timestep
+            pm.spawn_effect(ParticleEffect((emitter,)), (5, 10))
+            for dt in steps:
+                pm.update(dt)
+
+            surf = pygame.Surface((10, 120))
+            pm.draw(surf)
+
+            return pygame.image.tobytes(surf, "RGB")
+
+        self.assertEqual(render(1.0, (2.5,)), render(0, (1.0, 1.0, 0.5)))
+
+    def test_update_and_draw(self):
+        img = pygame.Surface((2, 2))
+        img.fill((255, 255, 255))
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=50,
+            animation=(img,),
+            particle_lifetime=(4, 12),
+            speed_x=(-2, 2),
+            speed_y=(-2, 2),
+        )
+        effect = ParticleEffect((emitter, emitter))
+
+        def render(fused, fixed_timestep=0):
+            pm = ParticleManager(seed=3)
+            pm.fixed_timestep = fixed_timestep
+            pm.spawn_effect(effect, (50, 50))
+            pm.spawn_effect(effect, (30, 70))
+
+            surf = pygame.Surface((100, 100))
+            for _ in range(10):
+                if fused:
+                    pm.update_and_draw(0.75, surf)
+                else:
+                    pm.update(0.75)
+                    pm.draw(surf)
+
+            return pygame.image.tobytes(surf, "RGB"), pm.num_particles
+
+        self.assertEqual(render(True), render(False))
+        self.assertEqual(render(True, 0.5), render(False, 0.5))
+
+        with self.assertRaises(TypeError):
+            ParticleManager().update_and_draw(1.0)
+
+    def test_constant_lifetime(self):
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=20,
+            animation=(pygame.Surface((2, 2)),),
+            particle_lifetime=5,
+            speed_x=(-1, 1),
+        )
+        pm = ParticleManager()
+        pm.spawn_effect(ParticleEffect((emitter,)), (10, 10))
+
+        pm.update(4.0)
+        self.assertEqual(pm.num_particles, 20)
+        pm.draw(pygame.Surface((20, 20)))
+
+        pm.update(1.5)
+        self.assertEqual(pm.num_particles, 0)
+
+    def test_rotated_emitter(self):
+        img = pygame.Surface((3, 2))
+        img.fill((255, 0, 0))
+        img.set_at((2, 0), (0, 255, 0))
+
+        def render(age=0, **kwargs):
+            emitter = Emitter(
+                emit_shape=EMIT_POINT,
+                emit_number=1,
+                animation=(img,),
+                particle_lifetime=100,
+                blend_mode=0,
+                **kwargs,
+            )
+            pm = ParticleManager()
+            pm.spawn_effect(ParticleEffect((emitter,)), (10, 10))
+            if age:
+                pm.update(age)
+
+            surf = pygame.Surface((20, 20))
+            pm.draw(surf)
+
+            return surf
+
+        # a quarter turn counterclockwise around the center of the frame
+        surf = render(angle=90, rotation_steps=4)
+        self.assertEqual(surf.get_at((10, 9)), pygame.Color(0, 255, 0))
+        self.assertEqual(surf.get_at((11, 11)), pygame.Color(255, 0, 0))
+        self.assertEqual(surf.get_at((12, 10)), pygame.Color(0, 0, 0))
+
+        # the angle follows the angular velocity, rounded to the closest step
+        surf = render(age=2, angular_velocity=50, rotation_steps=4)
+        self.assertEqual(surf.get_at((10, 9)), pygame.Color(0, 255, 0))
+        self.assertEqual(surf.get_at((12, 10)), pygame.Color(0, 0, 0))
+
+        # scaled sprites grow around the center of the frame too
+        surf = render(scale=2)
+        self.assertEqual(surf.get_at((8, 9)), pygame.Color(255, 0, 0))
+        self.assertEqual(surf.get_at((13, 12)), pygame.Color(255, 0, 0))
+        self.assertEqual(surf.get_at((12, 9)), pygame.Color(0, 255, 0))
+        self.assertEqual(surf.get_at((7, 9)), pygame.Color(0, 0, 0))
+        self.assertEqual(surf.get_at((13, 13)), pygame.Color(0, 0, 0))
+
+        with self.assertRaises(ValueError):
+            render(scale=0)
+
+        with self.assertRaises(ValueError):
+            render(angle=(0, 360), rotation_steps=0)
+
+        for kwargs in (
+            {"angle": float("nan")},
+            {"angle": (0, float("inf"))},
+            {"angular_velocity": float("-inf")},
+            {"scale": float("nan")},
+        ):
+            with self.assertRaises(ValueError):
+                render(**kwargs)
+
+        # an angle that overflows while drawing falls back to the first step
+        surf = render(age=10, angular_velocity=3e38, rotation_steps=4)
+        self.assertEqual(surf.get_at((11, 11)), pygame.Color(255, 0, 0))
+
+    def test_streak_emitter(self):
+        # black pixels are left out of the color a streak is drawn in
+        img = pygame.Surface((3, 1))
+        img.fill((0, 0, 0))
+        img.set_at((0, 0), (30, 60, 90))
+        img.set_at((1, 0), (50, 100, 150))
+
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=1,
+            animation=(img,),
+            particle_lifetime=100,
+            speed_x=4,
+            streak=1,
+        )
+        pm = ParticleManager()
+        pm.spawn_effect(ParticleEffect((emitter,)), (10, 10))
+
+        surf = pygame.Surface((20, 20))
+        pm.draw(surf)
+
+        # from the particle back to where it was one time unit ago
+        for x in range(6, 11):
+            self.assertEqual(surf.get_at((x, 10)), pygame.Color(40, 80, 120))
+        self.assertEqual(surf.get_at((5, 10)), pygame.Color(0, 0, 0))
+        self.assertEqual(surf.get_at((11, 10)), pygame.Color(0, 0, 0))
+
+        def render(level):
+            with simd_level(level):
+                emitter = Emitter(
+                    emit_shape=EMIT_POINT,
+                    emit_number=97,
+                    animation=(img,),
+                    particle_lifetime=(20, 60),
+                    speed_x=(-6, 6),
+                    speed_y=(-6, 6),
+                    streak=2.5,
+                )
+                pm = ParticleManager(seed=11)
+                pm.spawn_effect(ParticleEffect((emitter,)), (30, 30))
+                pm.update(3.0)
+
+                surf = pygame.Surface((60, 60))
+                pm.draw(surf)
+
+                return pygame.image.tobytes(surf, "RGB")
+
+        reference = render(SIMD_NONE)
+        self.assertEqual(render(SIMD_SSE2), reference)
+        self.assertEqual(render(SIMD_AVX2), reference)
+
+        with self.assertRaises(ValueError):
+            Emitter(
+                emit_shape=EMIT_POINT,
+                emit_number=1,
+                animation=(img,),
+                particle_lifetime=100,
+                streak=-1,
+            )
+
+    def test_stats(self):
+        imgs = tuple(pygame.Surface((s, s)) for s in (3, 2, 1))
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=50,
+            animation=imgs,
+            particle_lifetime=10,
+            speed_x=(-1, 1),
+        )
+        effect = ParticleEffect((emitter,))
+        surf = pygame.Surface((100, 100))
+
+        pm = ParticleManager()
+        self.assertFalse(pm.profiling)
+
+        pm.profiling = True
+        pm.spawn_effect(effect, (50, 50))
+        pm.update(1.0)
+        pm.draw(surf)
+
+        stats = pm.stats()
+        self.assertEqual(stats["particles_updated"], 50)
+        self.assertEqual(stats["destinations"], 50)
+        self.assertEqual(stats["particles_culled"], 0)
+        self.assertGreater(stats["bytes_allocated"], 0)
+        self.assertGreater(stats["pixels_blended"], 0)
+
+        # sprites are blitted as the map is built, that's all blit time
+        self.assertGreater(stats["blit_ns"], 0)
+        self.assertEqual(stats["destinations_ns"], 0)
+
+        # counters are reset by every stats() call
+        self.assertEqual(pm.stats()["particles_updated"], 0)
+
+        pm.profiling = False
+        pm.update(1.0)
+        self.assertEqual(pm.stats()["particles_updated"], 0)
+
+    def test_budget(self):
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=300,
+            animation=(pygame.Surface((2, 2)),),
+            particle_lifetime=10,
+        )
+        effect = ParticleEffect((emitter,))
+        surf = pygame.Surface((100, 100))
+
+        pm = ParticleManager()
+        pm.profiling = True
+        pm.spawn_effect(effect, (50, 50))
+
+        # already over budget, every third particle is drawn
+        pm.set_budget(max_particles=100)
+        pm.draw(surf)
+        stats = pm.stats()
+        self.assertEqual(stats["destinations"], 100)
+        self.assertEqual(stats["particles_decimated"], 200)
+
+        # bursts are scaled down to what's left, then dropped
+        pm = ParticleManager()
+        pm.set_budget(max_particles=400)
+        pm.spawn_effect(effect, (50, 50))
+        pm.spawn_effect(effect, (50, 50))
+        self.assertEqual(pm.num_particles, 400)
+        pm.spawn_effect(effect, (50, 50))
+        pm.update(1.0)
+        self.assertEqual(pm.num_particles, 400)
+
+        pm.set_budget()
+        pm.spawn_effect(effect, (50, 50))
+        self.assertEqual(pm.num_particles, 700)
+
+        with self.assertRaises(ValueError):
+            pm.set_budget(max_particles=-1)
+
+    def test_particle_system(self):
+        img = pygame.Surface((2, 2))
+        img.fill((255, 255, 255))
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=40,
+            animation=(img,),
+            particle_lifetime=(5, 20),
+            speed_x=(-2, 2),
+            speed_y=(-2, 2),
+        )
+        effect = ParticleEffect((emitter,))
+
+        def render(workers):
+            system = ParticleSystem(workers=workers, seed=11)
+            layers = (system.create_manager(), system.create_manager())
+            layers[0].add_attractor((50, 50), 1.0, 30.0)
+            for i, pm in enumerate(layers):
+                pm.spawn_effect(effect, (30 + 40 * i, 50))
+                pm.spawn_effect(effect, (50, 30 + 40 * i))
+
+            for _ in range(8):
+                system.update(1.0)
+
+            surf = pygame.Surface((100, 100))
+            for pm in layers:
+                pm.draw(surf)
+
+            return pygame.image.tobytes(surf, "RGB")
+
+        # layers are seeded from the system, the thread count doesn't matter
+        self.assertEqual(render(0), render(3))
+
+        system = ParticleSystem(workers=2)
+        self.assertEqual(system.workers, 2)
+        pm = system.create_manager()
+        pm.spawn_effect(effect, (50, 50))
+        system.update(1.0)
+        self.assertEqual(pm.num_particles, 40)
+        system.update(30.0)
+        self.assertEqual(pm.num_particles, 0)
+
+        # the default never exceeds what an explicit count may ask for
+        self.assertLessEqual(ParticleSystem().workers, 63)
+
+        with self.assertRaises(ValueError):
+            ParticleSystem(workers=-1)
+
+        with self.assertRaises(ValueError):
+            ParticleSystem(workers=64)
+
+    def test_trace(self):
+        imgs = (pygame.Surface((2, 2)),)
+        emitter = Emitter(
+            emit_shape=EMIT_POINT, emit_number=10, animation=imgs, particle_lifetime=5
+        )
+        effect = ParticleEffect((emitter,))
+        surf = pygame.Surface((20, 20))
+
+        pm = ParticleManager()
+        pm.spawn_effect(effect, (10, 10))
+
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, "trace.json")
+
+            pm.start_trace(path)
+            with self.assertRaises(RuntimeError):
+                pm.start_trace(path)
+
+            pm.update(1.0)
+            pm.draw(surf)
+            pm.stop_trace()
+
+            with open(path) as f:
+                events = json.load(f)["traceEvents"]
+
+        names = [e["name"] for e in events if e["ph"] == "B"]
+        for name in ("pm_update", "update_effect_instance", "pm_draw"):
+            self.assertIn(name, names)
+        self.assertIn("draw_data_block", names)
+        self.assertIn("blit_fragments", names)
+        self.assertEqual(
+            sum(e["ph"] == "B" for e in events), sum(e["ph"] == "E" for e in events)
+        )
+
+        with self.assertRaises(RuntimeError):
+            pm.stop_trace()
+
+    def test_effect_bounds(self):
+        img = pygame.Surface((1, 1))
+        img.fill((255, 255, 255))
+        white = pygame.Color(255, 255, 255)
+
+        def spawn(emit_number, position, **kwargs):
+            emitter = Emitter(
+                emit_shape=EMIT_POINT,
+                emit_number=emit_number,
+                animation=(img,),
+                particle_lifetime=1000,
+                speed_x=kwargs.pop("speed_x", (-4, 4)),
+                speed_y=kwargs.pop("speed_y", (-4, 4)),
+            )
+            pm = ParticleManager(seed=3)
+            pm.spawn_effect(ParticleEffect((emitter,), **kwargs), position)
+            return pm
+
+        def drawn_outside(pm, rect):
+            surf = pygame.Surface((100, 100))
+            pm.draw(surf)
+            surf.fill((0, 0, 0), rect)
+            return any(pygame.image.tobytes(surf, "RGB"))
+
+        # (int)x of a particle clamped to the right edge lands on x = 80
+        inside = (20, 20, 61, 41)
+
+        pm = spawn(100, (50, 50), bounds=(20, 20, 60, 40))
+        for _ in range(50):
+            pm.update(1.0)
+            self.assertFalse(drawn_outside(pm, inside))
+        self.assertEqual(pm.num_particles, 100)
+
+        pm = spawn(100, (50, 50), bounds=(20, 20, 60, 40), on_collision=COLLISION_KILL)
+        for _ in range(5):
+            pm.update(1.0)
+            self.assertFalse(drawn_outside(pm, inside))
+        self.assertGreater(pm.num_particles, 0)
+        self.assertLess(pm.num_particles, 100)
+
+        def position_after(steps, **kwargs):
+            pm = spawn(
+                1, (70, 50), speed_x=4, speed_y=2, bounds=(0, 0, 80, 100), **kwargs
+            )
+            for _ in range(steps):
+                pm.update(1.0)
+
+            surf = pygame.Surface((100, 100))
+            pm.draw(surf)
+            return next(
+                (x, y)
+                for y in range(100)
+                for x in range(100)
+                if surf.get_at((x, y)) == white
+            )
+
+        # the wall is hit on the third step, the particle is clamped to it
+        self.assertEqual(position_after(3), (80, 56))
+
+        # restitution scales the speed it leaves the wall with
+        self.assertEqual(position_after(5, restitution=0.5), (76, 60))
+        self.assertEqual(position_after(5, restitution=1.0), (72, 60))
+
+        # friction damps the speed along the wall
+        self.assertEqual(position_after(5, friction=0.5), (76, 58))
+        self.assertEqual(position_after(5, friction=1.0), (76, 56))
+
+        for kwargs in (
+            {"bounds": (20, 20, -60, 40)},
+            {"bounds": (20, 20, 60, float("nan"))},
+            {"restitution": -0.5},
+            {"friction": -0.1},
+            {"friction": 1.5},
+            {"friction": float("nan")},
+        ):
+            with self.assertRaises(ValueError):
+                spawn(1, (50, 50), **kwargs)
+
+    def test_set_collision_map(self):
+        pm = ParticleManager()
+        pm.set_collision_map(bytes([0, 1, 1, 0]), cell_size=8, size=(2, 2))
+        pm.set_collision_map(bytes([0b0110]), size=(4, 1), bits=1)
+        pm.clear_collision_map()
+
+        with self.assertRaises(ValueError):
+            pm.set_collision_map(bytes(3), size=(2, 2))
+
+        with self.assertRaises(ValueError):
+            pm.set_collision_map(bytes(4), cell_size=0, size=(2, 2))
+
+        with self.assertRaises(TypeError):
+            pm.set_collision_map(42)
+
+    def test_collision_map_response(self):
+        img = pygame.Surface((1, 1))
+        img.fill((255, 255, 255))
+        emitter = Emitter(
+            emit_shape=EMIT_POINT,
+            emit_number=50,
+            animation=(img,),
+            particle_lifetime=1000,
+            speed_x=(1, 3),
+        )
+        effect = ParticleEffect((emitter,))
+
+        # every cell from x = 96 on is solid
+        wall = bytes(x >= 12 for y in range(20) for x in range(20))
+        solid = (96, 0, 64, 160)
+
+        def lit(surf):
+            return any(pygame.image.tobytes(surf, "RGB"))
+
+        def run(on_collision, steps):
+            pm = ParticleManager(seed=5)
+            if on_collision is not None:
+                pm.set_collision_map(
+                    wall, cell_size=8, size=(20, 20), on_collision=on_collision
+                )
+            pm.spawn_effect(effect, (40, 80))
+
+            surf = pygame.Surface((160, 160))
+            for _ in range(steps):
+                pm.update(1.0)
+                surf.fill((0, 0, 0))
+                pm.draw(surf)
+                if on_collision is not None:
+                    self.assertFalse(lit(surf.subsurface(solid)))
+
+            return pm.num_particles, surf
+
+        # without a map the particles cross into the wall
+        count, surf = run(None, 40)
+        self.assertEqual(count, 50)
+        self.assertTrue(lit(surf.subsurface(solid)))
+
+        # nothing has reached the wall yet
+        self.assertEqual(run(COLLISION_KILL, 15)[0], 50)
+
+        count, _ = run(COLLISION_KILL, 40)
+        self.assertGreater(count, 0)
+        self.assertLess(count, 50)
+
+        # bounced particles head back out and none of them is lost
+        count, surf = run(COLLISION_BOUNCE, 60)
+        self.assertEqual(count, 50)
+        self.assertTrue(lit(surf))
+
+    def test_collision_map_simd(self):
+        img = pygame.Surface((1, 1))
+        img.fill((255, 255, 255))
+
+        # scattered solid cells with the last one set, so the vector gathers
+        # read right up to the end of the grid
+        grid = bytearray((x + 2 * y) % 7 == 3 for y in range(20) for x in range(20))
+        grid[-1] = 1
+
+        def render(level, on_collision):
+            with simd_level(level):
+                emitter = Emitter(
+                    emit_shape=EMIT_POINT,
+                    emit_number=203,
+                    animation=(img,),
+                    particle_lifetime=(40, 80),
+                    speed_x=(-4, 4),
+                    speed_y=(-4, 4),
+                )
+                pm = ParticleManager(seed=99)
+                pm.set_collision_map(
+                    bytes(grid), cell_size=8, size=(20, 20), on_collision=on_collision
+                )
+                pm.spawn_effect(ParticleEffect((emitter,)), (80, 80))
+
+                surf = pygame.Surface((200, 200))
+                for _ in range(40):
+                    pm.update(1.0)
+                pm.draw(surf)
+
+                return pm.num_particles, pygame.image.tobytes(surf, "RGB")
+
+        for on_collision in (COLLISION_BOUNCE, COLLISION_KILL):
+            reference = render(SIMD_NONE, on_collision)
+            self.assertEqual(render(SIMD_SSE2, on_collision), reference)
+            self.assertEqual(render(SIMD_AVX2, on_collision), reference)
+
 
 if __name__ == "__main__":
     unittest.main()